@@ -0,0 +1,67 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "benchmark/benchmark.h"
+
+#include "art/buffer.hpp"
+
+namespace {
+  const std::size_t bytes = 1 << 16;
+  
+  void buffer_write_u8(benchmark::State& state) {
+    art::real_t buf = art::buffer_create(bytes, static_cast<art::real_t>(state.range(0)), 1);
+    art::variant_t val(7.0);
+    for (auto _ : state) {
+      art::buffer_seek(buf, art::buffer_seek_start, 0);
+      for (std::size_t n = 0; n < bytes; ++n) {
+        art::buffer_write(buf, art::buffer_u8, val);
+      }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    art::buffer_delete(buf);
+  }
+  BENCHMARK(buffer_write_u8)->Arg(art::intern::bm_fixed)->Arg(art::intern::bm_fast);
+  
+  void buffer_read_u8(benchmark::State& state) {
+    art::real_t buf = art::buffer_create(bytes, static_cast<art::real_t>(state.range(0)), 1);
+    for (auto _ : state) {
+      art::buffer_seek(buf, art::buffer_seek_start, 0);
+      for (std::size_t n = 0; n < bytes; ++n) {
+        benchmark::DoNotOptimize(art::buffer_read(buf, art::buffer_u8));
+      }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    art::buffer_delete(buf);
+  }
+  BENCHMARK(buffer_read_u8)->Arg(art::intern::bm_fixed)->Arg(art::intern::bm_fast);
+  
+  // A netcode style packet: a few mixed fields at four byte alignment into a buffer that starts out empty
+  void buffer_write_packet(benchmark::State& state) {
+    art::variant_t id(1234.0), x(100.5), y(-20.25), name(art::string_t("player"));
+    std::size_t packets = 1000;
+    for (auto _ : state) {
+      art::real_t buf = art::buffer_create(0, art::buffer_grow, 4);
+      for (std::size_t n = 0; n < packets; ++n) {
+        art::buffer_write(buf, art::buffer_u16, id);
+        art::buffer_write(buf, art::buffer_f32, x);
+        art::buffer_write(buf, art::buffer_f32, y);
+        art::buffer_write(buf, art::buffer_string, name);
+      }
+      art::buffer_delete(buf);
+    }
+    state.SetItemsProcessed(state.iterations() * packets);
+  }
+  BENCHMARK(buffer_write_packet);
+  
+  void buffer_copy(benchmark::State& state) {
+    art::real_t from = art::buffer_create(bytes, art::buffer_fixed, 1);
+    art::real_t to = art::buffer_create(bytes, art::buffer_fixed, 1);
+    for (auto _ : state) {
+      art::buffer_copy(from, 0, bytes, to, 0);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    art::buffer_delete(from);
+    art::buffer_delete(to);
+  }
+  BENCHMARK(buffer_copy);
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "benchmark/benchmark.h"
+
+#include "art/object.hpp"
+
+#include <random>
+
+namespace {
+  const art::object::index_t ticker_index = 0;
+  const art::object::index_t other_index = 1;
+  
+  // Counts the steps it was performed for, about the cheapest useful step event there is
+  template <art::object::index_t index>
+  struct ticker : art::object {
+    unsigned long ticks = 0;
+    
+    ticker(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  template <art::object::index_t index>
+  void tick(art::object& self, const art::event::metadata_t) {
+    ++static_cast<ticker<index>&>(self).ticks;
+  }
+  
+  void register_types() {
+    static bool registered = false;
+    if (registered) {
+      return;
+    }
+    art::intern::object_register<ticker<ticker_index>>(ticker_index);
+    art::intern::object_register<ticker<other_index>>(other_index);
+    art::event ev;
+    ev.metadata = 0;
+    ev.type = art::ev_step;
+    ev.status = art::event::st_normal;
+    ev.fn = tick<ticker_index>;
+    art::intern::object_register_events(ticker_index, {ev});
+    ev.fn = tick<other_index>;
+    art::intern::object_register_events(other_index, {ev});
+    registered = true;
+  }
+  
+  // Creates count instances, every fourth of the other type, spread over a few depths, and runs a step so the
+  // schedule is in order before timing starts. Returns their ids.
+  std::vector<art::real_t> populate(std::size_t count) {
+    register_types();
+    std::mt19937 gen;
+    std::vector<art::real_t> ids;
+    for (std::size_t n = 0; n < count; ++n) {
+      art::real_t id = art::instance_create(n % 640, n / 640, (n % 4) ? ticker_index : other_index);
+      art::intern::object_from_id(static_cast<art::object::id_t>(id)).set_depth(gen() % 16);
+      ids.push_back(id);
+    }
+    art::intern::step();
+    return ids;
+  }
+  
+  void clear() {
+    art::with(art::all, [](art::object& obj) {
+      obj.instance_destroy();
+    });
+    art::intern::step();
+  }
+  
+  void instance_churn(benchmark::State& state) {
+    register_types();
+    std::vector<art::real_t> ids(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+      for (art::real_t& id : ids) {
+        id = art::instance_create(0, 0, ticker_index);
+      }
+      for (art::real_t id : ids) {
+        art::intern::object_from_id(static_cast<art::object::id_t>(id)).instance_destroy();
+      }
+      art::intern::objects_release();
+      art::intern::event_schedule_compact();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK(instance_churn)->Arg(1000)->Arg(10000);
+  
+  void with_all(benchmark::State& state) {
+    populate(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+      art::real_t sum = 0;
+      art::with(art::all, [&sum](art::object& obj) {
+        sum += obj._depth;
+      });
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    clear();
+  }
+  BENCHMARK(with_all)->Arg(1000)->Arg(10000)->Arg(100000);
+  
+  void with_index(benchmark::State& state) {
+    populate(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+      art::real_t sum = 0;
+      art::with(other_index, [&sum](art::object& obj) {
+        sum += obj._depth;
+      });
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) / 4);
+    clear();
+  }
+  BENCHMARK(with_index)->Arg(1000)->Arg(10000)->Arg(100000);
+  
+  void with_id(benchmark::State& state) {
+    std::vector<art::real_t> ids = populate(static_cast<std::size_t>(state.range(0)));
+    std::size_t next = 0;
+    for (auto _ : state) {
+      art::real_t sum = 0;
+      art::with(ids[next++ % ids.size()], [&sum](art::object& obj) {
+        sum += obj._depth;
+      });
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations());
+    clear();
+  }
+  BENCHMARK(with_id)->Arg(1000)->Arg(100000);
+  
+  // A tenth of the instances move to another depth every step, which the next dispatch has to put in order
+  void depth_change(benchmark::State& state) {
+    std::vector<art::real_t> ids = populate(static_cast<std::size_t>(state.range(0)));
+    std::mt19937 gen;
+    for (auto _ : state) {
+      for (std::size_t n = 0; n < ids.size() / 10; ++n) {
+        art::intern::object_from_id(static_cast<art::object::id_t>(ids[gen() % ids.size()])).set_depth(gen() % 16);
+      }
+      art::intern::event_perform(art::ev_step);
+      art::intern::event_schedule_compact();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    clear();
+  }
+  BENCHMARK(depth_change)->Arg(1000)->Arg(10000)->Arg(100000);
+  
+  void event_dispatch(benchmark::State& state) {
+    populate(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+      art::intern::event_perform(art::ev_step);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    clear();
+  }
+  BENCHMARK(event_dispatch)->Arg(1000)->Arg(10000)->Arg(100000);
+  
+  void full_step(benchmark::State& state) {
+    std::vector<art::real_t> ids = populate(static_cast<std::size_t>(state.range(0)));
+    for (std::size_t n = 0; n < ids.size(); n += 2) {
+      art::intern::object_from_id(static_cast<art::object::id_t>(ids[n])).set_hspeed(1);
+    }
+    for (auto _ : state) {
+      art::intern::step();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    clear();
+  }
+  BENCHMARK(full_step)->Arg(1000)->Arg(10000)->Arg(100000);
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "benchmark/benchmark.h"
+
+#include "art/random.hpp"
+
+namespace {
+  void random(benchmark::State& state) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(art::random(100));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(random);
+  
+  void random_range(benchmark::State& state) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(art::random_range(-50, 50));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(random_range);
+  
+  void irandom_range(benchmark::State& state) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(art::irandom_range(0, 10));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(irandom_range);
+  
+  void choose(benchmark::State& state) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(art::choose(1.0, 2.0, 3.0, art::string_t("four")));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(choose);
+  
+  void random_set_seed(benchmark::State& state) {
+    art::real_t seed = 0;
+    for (auto _ : state) {
+      art::random_set_seed(++seed);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(random_set_seed);
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "benchmark/benchmark.h"
+
+#include "art/variant.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+  // Reals, short strings and strings too long for any small string buffer, in equal parts
+  std::vector<art::variant> mixed(std::size_t count) {
+    std::vector<art::variant> vars;
+    for (std::size_t n = 0; n < count; ++n) {
+      switch (n % 3) {
+        case 0:
+          vars.emplace_back(static_cast<art::real_t>(n));
+          break;
+        case 1:
+          vars.emplace_back(art::string_t("name") + std::to_string(n % 100));
+          break;
+        default:
+          vars.emplace_back(art::string_t("a rather longer string value number ") + std::to_string(n));
+          break;
+      }
+    }
+    return vars;
+  }
+  
+  void variant_copy_real(benchmark::State& state) {
+    art::variant from(42.0);
+    for (auto _ : state) {
+      art::variant to(from);
+      benchmark::DoNotOptimize(to);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(variant_copy_real);
+  
+  void variant_copy_string(benchmark::State& state) {
+    art::variant from(art::string_t(static_cast<std::size_t>(state.range(0)), 'x'));
+    for (auto _ : state) {
+      art::variant to(from);
+      benchmark::DoNotOptimize(to);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(variant_copy_string)->Arg(8)->Arg(64);
+  
+  void variant_copy_vector(benchmark::State& state) {
+    std::vector<art::variant> vars = mixed(1000);
+    for (auto _ : state) {
+      std::vector<art::variant> copy(vars);
+      benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 1000);
+  }
+  BENCHMARK(variant_copy_vector);
+  
+  void variant_compare_real(benchmark::State& state) {
+    std::vector<art::variant> vars;
+    for (int n = 0; n < 1000; ++n) {
+      vars.emplace_back(static_cast<art::real_t>((n * 7919) % 1000));
+    }
+    for (auto _ : state) {
+      std::size_t less = 0;
+      for (std::size_t n = 1; n < vars.size(); ++n) {
+        less += vars[n - 1] < vars[n];
+      }
+      benchmark::DoNotOptimize(less);
+    }
+    state.SetItemsProcessed(state.iterations() * 999);
+  }
+  BENCHMARK(variant_compare_real);
+  
+  void variant_compare_string(benchmark::State& state) {
+    std::vector<art::variant> vars = mixed(3000);
+    std::vector<art::variant> strings;
+    for (const art::variant& var : vars) {
+      if (var.type() == art::variant::vt_string) {
+        strings.push_back(var);
+      }
+    }
+    for (auto _ : state) {
+      std::size_t less = 0;
+      for (std::size_t n = 1; n < strings.size(); ++n) {
+        less += strings[n - 1] < strings[n];
+      }
+      benchmark::DoNotOptimize(less);
+    }
+    state.SetItemsProcessed(state.iterations() * (strings.size() - 1));
+  }
+  BENCHMARK(variant_compare_string);
+  
+  void variant_sort_strings(benchmark::State& state) {
+    std::vector<art::variant> strings;
+    for (const art::variant& var : mixed(3000)) {
+      if (var.type() == art::variant::vt_string) {
+        strings.push_back(var);
+      }
+    }
+    for (auto _ : state) {
+      std::vector<art::variant> sorted(strings);
+      std::sort(sorted.begin(), sorted.end());
+      benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * strings.size());
+  }
+  BENCHMARK(variant_sort_strings);
+  
+  // A ds_map style lookup on keys of either type
+  void variant_map_find(benchmark::State& state) {
+    std::vector<art::variant> keys = mixed(3000);
+    std::unordered_map<art::variant, std::size_t> map;
+    for (std::size_t n = 0; n < keys.size(); ++n) {
+      map[keys[n]] = n;
+    }
+    for (auto _ : state) {
+      std::size_t found = 0;
+      for (const art::variant& key : keys) {
+        found += map.count(key);
+      }
+      benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+  }
+  BENCHMARK(variant_map_find);
+  
+  // What a score display does every frame
+  void variant_real_to_string(benchmark::State& state) {
+    std::vector<art::variant> vars;
+    for (int n = 0; n < 1000; ++n) {
+      vars.emplace_back((n % 2) ? n * 37.0 : n / 7.0);
+    }
+    for (auto _ : state) {
+      for (const art::variant& var : vars) {
+        benchmark::DoNotOptimize(art::string(var));
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * vars.size());
+  }
+  BENCHMARK(variant_real_to_string);
+  
+  void variant_string_to_real(benchmark::State& state) {
+    std::vector<art::variant> vars;
+    for (int n = 0; n < 1000; ++n) {
+      vars.emplace_back(art::string((n % 2) ? n * 37.0 : n / 7.0));
+    }
+    for (auto _ : state) {
+      for (const art::variant& var : vars) {
+        benchmark::DoNotOptimize(art::real(var));
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * vars.size());
+  }
+  BENCHMARK(variant_string_to_real);
+}
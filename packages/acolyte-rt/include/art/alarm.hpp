@@ -0,0 +1,58 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_ALARM_HPP_
+#define ART_ALARM_HPP_
+
+#include "art/object.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace art {
+  namespace intern {
+    // Hierarchical timing wheel holding every set alarm, keyed by the step it goes off at. Level 0 has a slot per
+    // step for the next 256 steps, each level above covers 256 times the range of the one below it, and alarms even
+    // further out wait in overflow. Whenever a slot of a higher level comes up, its entries are spread over the levels
+    // below, so advancing a step only touches the alarms that are due and instances without alarms cost nothing.
+    //
+    // Entries are never removed: an instance's _alarm holds the deadline it is waiting for, and entries which no
+    // longer match it, because the alarm was set again or the instance is gone, are dropped when they come due.
+    struct alarm_wheel {
+      static const unsigned slot_bits = 8;
+      static const std::size_t slot_count = std::size_t(1) << slot_bits;
+      static const std::size_t level_count = 4;
+      
+      struct entry {
+        object::id_t id;
+        std::size_t n;
+        std::uint64_t deadline;
+      };
+      
+      std::array<std::array<std::vector<entry>, slot_count>, level_count> levels;
+      std::vector<entry> overflow;
+      
+      // Number of steps advanced so far, alarms set now go off at now + steps
+      std::uint64_t now = 0;
+      
+      // Number of steps covered by the slots of the given number of levels
+      static std::uint64_t span(std::size_t levels) {
+        return std::uint64_t(1) << (slot_bits * levels);
+      }
+      
+      void schedule(const entry&);
+      
+      // Moves on to the next step and appends the entries due at it to the given vector
+      void advance(std::vector<entry>&);
+    };
+    
+    extern alarm_wheel alarms;
+    
+    // Advances the wheel and performs the alarm events that went off, per instance in id order and then by alarm
+    // number.
+    void alarms_perform();
+  }
+}
+
+#endif // ART_ALARM_HPP_
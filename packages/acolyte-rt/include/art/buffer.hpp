@@ -5,29 +5,112 @@
 #define ART_BUFFER_HPP_
 
 #include "art/rt.hpp"
+#include "art/object.hpp"
 #include "art/variant.hpp"
 
+#include <memory>
+#include <vector>
+
 namespace art {
-  exposed unsigned buffer_fixed   = 0;
-  exposed unsigned buffer_grow    = 1;
-  exposed unsigned buffer_wrap    = 2;
-  exposed unsigned buffer_fast    = 3;
-  
-  exposed unsigned buffer_u8      = 1;
-  exposed unsigned buffer_s8      = 2;
-  exposed unsigned buffer_u16     = 3;
-  exposed unsigned buffer_s16     = 4;
-  exposed unsigned buffer_u32     = 5;
-  exposed unsigned buffer_s32     = 6;
-  exposed unsigned buffer_f16     = 7;
-  exposed unsigned buffer_f32     = 8;
-  exposed unsigned buffer_f64     = 9;
-  exposed unsigned buffer_bool    = 10;
-  exposed unsigned buffer_string  = 11;
-
-  exposed unsigned buffer_seek_start    = 0;
-  exposed unsigned buffer_seek_relative = 1;
-  exposed unsigned buffer_seek_end      = 2;
+  namespace intern {
+    enum buffer_mode_t {
+      bm_fixed = 0,
+      bm_grow,
+      bm_wrap,
+      bm_fast
+    };
+
+    enum buffer_type_t {
+      bt_u8 = 1,
+      bt_s8,
+      bt_u16,
+      bt_s16,
+      bt_u32,
+      bt_s32,
+      bt_f16,
+      bt_f32,
+      bt_f64,
+      bt_bool,
+      bt_string
+    };
+
+    // A block of bytes with a position that reads and writes advance. Storage is aligned to the buffer's alignment,
+    // and every read or write first rounds the position up to a multiple of it. Values are stored in the machine's
+    // byte order with no padding of their own, so they are loaded and stored with unaligned accesses.
+    struct buffer {
+      std::unique_ptr<unsigned char[]> storage;
+      unsigned char* data = nullptr;
+      std::size_t size = 0;
+      std::size_t capacity = 0;
+      std::size_t alignment = 1;
+      std::size_t pos = 0;
+      buffer_mode_t mode = bm_fixed;
+      // Sets the buffer apart from others that used its index before, so late asynchronous loads can tell them apart
+      unsigned long generation;
+
+      // Set when the contents are a private mapping of a file rather than storage. Pages of the file are read as
+      // they are first touched and copied as they are first written, the file itself never changes.
+      void* mapping = nullptr;
+      std::size_t mapping_size = 0;
+
+      buffer(std::size_t, buffer_mode_t, std::size_t);
+      ~buffer();
+
+      // Changes the size, keeping the contents that still fit and zeroing any new bytes. Growing past the capacity
+      // reallocates to at least twice the old one, so a grow buffer written a byte at a time copies in amortised
+      // constant time. A mapped buffer is copied into storage the first time it grows past the file.
+      void resize(std::size_t);
+
+      // Moves the position past a value of n bytes at the next aligned offset and returns where it starts, or null
+      // when it does not fit. Grow buffers are resized to fit writes, wrap buffers start over from their beginning.
+      unsigned char* advance(std::size_t, bool);
+    };
+
+    // Buffers by index, null where one was deleted. Deleted indices are handed out again, lowest first.
+    extern std::vector<std::unique_ptr<buffer>> buffers;
+
+    buffer& buffer_from_index(real_t);
+    std::size_t buffer_type_size(buffer_type_t);
+
+    // Bytes a value takes once written, strings include their terminating null
+    std::size_t buffer_value_size(buffer_type_t, const variant_t&);
+    // Reads a value, looking at no more than the given number of bytes for the end of a string
+    variant_t buffer_load_value(const unsigned char*, std::size_t, buffer_type_t);
+    // Writes a value, which must have room for buffer_value_size bytes
+    void buffer_store_value(unsigned char*, buffer_type_t, const variant_t&);
+
+    // Files bigger than this are mapped by buffer_load where the platform allows, smaller ones are read
+    const std::size_t buffer_mapping_threshold = 1 << 16;
+
+    // Loads and saves started by buffer_load_async and buffer_save_async run in order on a thread of their own. Each
+    // one that has finished since the last step is reported by performing the Async Save/Load events, with
+    // buffer_async_id and buffer_async_status describing it.
+    void buffer_async_perform();
+  }
+
+  // The subtype of ev_other performed when an asynchronous load or save finishes
+  const event::metadata_t ev_async_save_load = 72;
+
+  exposed const unsigned buffer_fixed;
+  exposed const unsigned buffer_grow;
+  exposed const unsigned buffer_wrap;
+  exposed const unsigned buffer_fast;
+
+  exposed const unsigned buffer_u8;
+  exposed const unsigned buffer_s8;
+  exposed const unsigned buffer_u16;
+  exposed const unsigned buffer_s16;
+  exposed const unsigned buffer_u32;
+  exposed const unsigned buffer_s32;
+  exposed const unsigned buffer_f16;
+  exposed const unsigned buffer_f32;
+  exposed const unsigned buffer_f64;
+  exposed const unsigned buffer_bool;
+  exposed const unsigned buffer_string;
+
+  exposed const unsigned buffer_seek_start;
+  exposed const unsigned buffer_seek_relative;
+  exposed const unsigned buffer_seek_end;
 
   exposed real_t buffer_create(real_t, real_t, real_t);
   exposed real_t buffer_delete(real_t);
@@ -42,6 +125,10 @@ namespace art {
   exposed real_t buffer_save_ext(real_t, const string_t&, real_t, real_t);
   exposed real_t buffer_load(const string_t&);
   exposed real_t buffer_load_ext(real_t, const string_t&, real_t);
+  exposed real_t buffer_save_async(real_t, const string_t&, real_t, real_t);
+  exposed real_t buffer_load_async(real_t, const string_t&, real_t, real_t);
+  exposed real_t buffer_async_id();
+  exposed real_t buffer_async_status();
   exposed real_t buffer_copy(real_t, real_t, real_t, real_t, real_t);
   exposed real_t buffer_get_size(real_t);
   exposed real_t buffer_resize(real_t, real_t);
@@ -0,0 +1,130 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_COLLISION_HPP_
+#define ART_COLLISION_HPP_
+
+#include "art/object.hpp"
+#include "art/sprite.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace art {
+  namespace intern {
+    inline bool bbox_overlaps(const bbox& a, const bbox& b) {
+      return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+    
+    void object_bbox_update(const object&);
+    
+    // Bounding box of the instance's mask relative to its position, from its cache
+    inline const bbox_cache& object_bbox_local(const object& obj) {
+      if (obj._bbox.generation != sprites_generation) {
+        object_bbox_update(obj);
+      }
+      return obj._bbox;
+    }
+    
+    // Bounding box of the instance's mask as if it was placed at (x, y), false if it has nothing to collide with
+    inline bool object_bbox(const object& obj, real_t x, real_t y, bbox& box) {
+      const bbox_cache& cache = object_bbox_local(obj);
+      box.left = x + cache.local.left;
+      box.top = y + cache.local.top;
+      box.right = x + cache.local.right;
+      box.bottom = y + cache.local.bottom;
+      return cache.masked;
+    }
+    
+    inline bool object_bbox(const object& obj, bbox& box) {
+      return object_bbox(obj, motion.x[obj._motion], motion.y[obj._motion], box);
+    }
+    
+    // Uniform grid over the bounding boxes of every instance with a mask. Moving an instance only marks it dirty,
+    // the grid is brought up to date in one batch before the next query so instances that move several times a
+    // step are rehashed once. Instances spanning too many cells are kept in a separate list every query checks.
+    struct spatial_grid {
+      static const long max_span = 16;
+      
+      real_t cell_size = 64;
+      std::unordered_map<std::uint64_t, std::vector<object*>> cells;
+      std::vector<object*> oversized;
+      std::vector<object*> dirty;
+      std::vector<object*> found;
+      unsigned long query = 0;
+      
+      long cell(real_t pos) const {
+        return static_cast<long>(std::floor(pos / this->cell_size));
+      }
+      
+      static std::uint64_t key(long cx, long cy) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32) | static_cast<std::uint32_t>(cy);
+      }
+      
+      void touch(object& obj) {
+        if (!obj._grid.dirty) {
+          obj._grid.dirty = true;
+          obj._grid.dirty_slot = this->dirty.size();
+          this->dirty.push_back(&obj);
+        }
+      }
+      
+      void remove(object&);
+      void forget(object&);
+      void update();
+      
+      // Calls fn once for every instance whose cells overlap the box. Candidates are gathered onto the shared found
+      // stack first, so fn may itself query the grid.
+      template <typename F>
+      void each(const bbox& box, F fn) {
+        this->update();
+        std::size_t base = this->found.size();
+        unsigned long stamp = ++this->query;
+        auto gather = [this, stamp](std::vector<object*>& candidates) {
+          for (object* obj : candidates) {
+            if (obj->_grid.query != stamp) {
+              obj->_grid.query = stamp;
+              this->found.push_back(obj);
+            }
+          }
+        };
+        
+        long left = this->cell(box.left), top = this->cell(box.top);
+        long right = this->cell(box.right), bottom = this->cell(box.bottom);
+        if (static_cast<real_t>(right - left + 1) * (bottom - top + 1) > this->cells.size()) {
+          // Cheaper to look at every occupied cell than to probe the whole range
+          for (auto& entry : this->cells) {
+            gather(entry.second);
+          }
+        } else {
+          for (long cy = top; cy <= bottom; ++cy) {
+            for (long cx = left; cx <= right; ++cx) {
+              auto it = this->cells.find(key(cx, cy));
+              if (it != this->cells.end()) {
+                gather(it->second);
+              }
+            }
+          }
+        }
+        gather(this->oversized);
+        
+        for (std::size_t i = base; i < this->found.size(); ++i) {
+          if (!this->found[i]->_destroyed) {
+            fn(*this->found[i]);
+          }
+        }
+        this->found.resize(base);
+      }
+    };
+    
+    extern spatial_grid grid;
+    
+    bool object_matches(const object&, real_t);
+    
+    // Performs the collision events of every instance against the instances it overlaps
+    void collision_perform();
+  }
+}
+
+#endif // ART_COLLISION_HPP_
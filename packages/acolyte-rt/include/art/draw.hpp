@@ -0,0 +1,29 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_DRAW_HPP_
+#define ART_DRAW_HPP_
+
+#include "art/collision.hpp"
+
+namespace art {
+  namespace intern {
+    // The part of the room on screen. Culling is opt-in: draw events are free to draw anywhere, so only games whose
+    // draw events stay within their sprite's image can have them skipped when that image is off screen.
+    struct draw_view {
+      bool culling = false;
+      bbox area;
+    };
+    
+    extern draw_view view;
+    
+    void view_cull(real_t, real_t, real_t, real_t);
+    void view_uncull();
+    
+    // Performs the draw events of every visible instance in depth order. Invisible instances are not in the draw
+    // schedule at all; with culling on, instances with a sprite whose image lies outside the view are skipped too.
+    void draw_perform();
+  }
+}
+
+#endif // ART_DRAW_HPP_
@@ -0,0 +1,70 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_NEAREST_HPP_
+#define ART_NEAREST_HPP_
+
+#include "art/collision.hpp"
+
+#include <vector>
+
+namespace art {
+  namespace intern {
+    // 2-d tree over the positions of a single object_index's instances, used to answer nearest and furthest queries
+    // without visiting every instance. The tree is implicit: each range of points is split at its median, which sits
+    // in the middle of the range, alternating between the x and y axis.
+    //
+    // The tree is only built when queried and is not updated as instances move. Instances created or moved since it
+    // was built are stamped with its generation and kept in a short list that every query checks, their entries in
+    // the tree are skipped. Once that list grows too long, or an instance of the type is released, the tree is
+    // dropped and rebuilt by the next query.
+    struct nearest_index {
+      struct point {
+        real_t x;
+        real_t y;
+        object* obj;
+      };
+
+      std::vector<point> points;
+      std::vector<object*> moved;
+      bbox bounds;
+      unsigned long generation = 0;
+
+      void build(object::index_t);
+      void invalidate();
+    };
+
+    extern std::vector<nearest_index> nearest_indices;
+
+    inline void nearest_touch(object& obj) {
+      if (obj._index >= nearest_indices.size()) {
+        return;
+      }
+      nearest_index& index = nearest_indices[obj._index];
+      if (index.generation && obj._nearest != index.generation) {
+        obj._nearest = index.generation;
+        index.moved.push_back(&obj);
+        if (index.moved.size() > index.points.size() / 4 + 16) {
+          index.invalidate();
+        }
+      }
+    }
+
+    inline void nearest_forget(object& obj) {
+      if (obj._index < nearest_indices.size() && nearest_indices[obj._index].generation) {
+        nearest_indices[obj._index].invalidate();
+      }
+    }
+
+    // The k instances of index (or all) nearest to or furthest from (x, y), best first. Instances at the same
+    // distance are ordered by id.
+    void instances_nearest(real_t, real_t, real_t, std::size_t, std::vector<object*>&);
+    void instances_furthest(real_t, real_t, real_t, std::size_t, std::vector<object*>&);
+
+    // Resolves instance_nearest for every instance in from at its own position. The trees are brought up to date
+    // once up front, after which the queries only read shared state and large batches are split across threads.
+    void instances_nearest_batch(const std::vector<object*>&, real_t, std::vector<real_t>&);
+  }
+}
+
+#endif // ART_NEAREST_HPP_
@@ -5,16 +5,56 @@
 #define ART_OBJECT_HPP_
 
 #include "art/real.hpp"
+#include "art/profile.hpp"
 #include "art/property.hpp"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <vector>
-#include <deque>
-#include <map>
 
 namespace art {
   struct event;
   
+  namespace intern {
+    const std::size_t alarm_count = 12;
+    
+    // Where an instance is filed in intern::grid, as an inclusive range of cells
+    struct grid_entry {
+      long left;
+      long top;
+      long right;
+      long bottom;
+      unsigned long query;
+      // Position in spatial_grid::dirty while dirty, so the instance can be taken off it in constant time
+      std::size_t dirty_slot;
+      bool linked;
+      bool dirty;
+    };
+    
+    struct bbox {
+      real_t left;
+      real_t top;
+      real_t right;
+      real_t bottom;
+    };
+    
+    // An instance's bounding box relative to its position, so moving the instance leaves it valid. It is recomputed
+    // on the next read once the mask, scale, angle or (for masks with a shape per frame) the frame changes. Next to
+    // the mask's box it keeps the area the whole sprite image covers when drawn.
+    struct bbox_cache {
+      bbox local;
+      bbox drawn;
+      long frame;
+      unsigned long generation;
+      bool masked;
+      bool sprited;
+      bool per_frame;
+    };
+  }
+  
 #define def_property(__type, __name) \
   __type get_##__name (); \
   void set_##__name (__type); \
@@ -28,23 +68,29 @@ namespace art {
     typedef unsigned long index_t;
     typedef unsigned long id_t;
     
-    object(index_t, id_t, real_t, real_t, bool, bool, bool, real_t, real_t, real_t, std::vector<event>&);
-    virtual ~object();
+    object(index_t, id_t, real_t, real_t, bool, bool, bool, real_t, real_t, real_t);
+    ~object();
     
-    virtual void event_create() = 0;
-    virtual void event_destroy() = 0;
+    // Performs the create and destroy events registered for the instance's object_index
+    void event_create();
+    void event_destroy();
     
-    std::vector<event> defined_events;
-    std::vector<std::multimap<real_t, event>::iterator> linked_events;
+    // Where each of the object_index's events is linked in the schedule, or intern::event_unlinked for the draw
+    // events of an invisible instance
+    std::vector<std::size_t> linked_events;
     
     void unsafe_link_events();
     void link_events();
     void unsafe_unlink_events();
     void unlink_events();
     
+    // Links or unlinks the draw events to match the instance's visibility
+    void update_draw_events();
+    
     void instance_change(real_t, bool);
     real_t instance_copy(bool);
     void instance_destroy();
+    real_t instance_place(real_t, real_t, real_t);
     
     const index_t _index;
     def_property_ro(index_t, object_index);
@@ -52,16 +98,35 @@ namespace art {
     const id_t _id;
     def_property_ro(id_t, id);
     
+    bool _destroyed;
+    
+    // Siblings in the intrusive list of instances sharing this object_index
+    object* _type_prev;
+    object* _type_next;
+    
     const real_t _xstart;
     def_property_ro(real_t, xstart);
     
     const real_t _ystart;
     def_property_ro(real_t, ystart);
     
-    real_t _x;
-    def_property(real_t, x);
+    // Slot in intern::motion holding this instance's position and velocity
+    std::size_t _motion;
+    intern::grid_entry _grid;
     
-    real_t _y;
+    mutable intern::bbox_cache _bbox;
+    void bbox_changed();
+    void position_changed();
+    
+    // Generation of this type's intern::nearest_index the instance was last moved in
+    unsigned long _nearest;
+    
+    // Step of intern::alarms each alarm goes off at, 0 while it is not set
+    std::array<std::uint64_t, intern::alarm_count> _alarm;
+    real_t get_alarm(real_t);
+    void set_alarm(real_t, real_t);
+    
+    def_property(real_t, x);
     def_property(real_t, y);
     
     bool _solid;
@@ -82,10 +147,7 @@ namespace art {
     real_t _mask_index;
     def_property(real_t, mask_index);
     
-    real_t _xprevious;
     def_property_ro(real_t, xprevious);
-    
-    real_t _yprevious;
     def_property_ro(real_t, yprevious);
     
     real_t _image_alpha;
@@ -109,36 +171,20 @@ namespace art {
     real_t _image_yscale;
     def_property(real_t, image_yscale);
     
-    real_t _direction;
     def_property(real_t, direction);
-    void update_direction();
     
-    real_t _friction;
-    real_t _hfriction;
-    real_t _vfriction;
     def_property(real_t, friction);
-    void update_friction();
     
     real_t _gravity;
-    real_t _hgravity;
-    real_t _vgravity;
     def_property(real_t, gravity);
     void update_gravity();
     
     real_t _gravity_direction;
     def_property(real_t, gravity_direction);
     
-    real_t _speed;
     def_property(real_t, speed);
-    void update_speed();
-    
-    real_t _hspeed;
     def_property(real_t, hspeed);
-    void update_hspeed();
-    
-    real_t _vspeed;
     def_property(real_t, vspeed);
-    void update_vspeed();
     
     def_property_ro(real_t, sprite_width);
     def_property_ro(real_t, sprite_height);
@@ -167,12 +213,20 @@ namespace art {
     ev_keyrelease
   };
   
+  // Handlers are plain functions called with the instance the event was linked for, so dispatch costs one indirect
+  // call and storing an event never allocates.
   struct event {
     typedef object::index_t metadata_t;
-    std::function<void(const metadata_t)> fn;
+    typedef void (*fn_t)(object&, const metadata_t);
+    fn_t fn;
     metadata_t metadata;
     event_type_t type;
     
+    // Set on events that only read and write their own instance, which may run in parallel with each other. Such
+    // events must not make collision or nearest instance queries, which read other instances and update the grid and
+    // trees they share; the runtime stops with an error when one does while running in parallel.
+    bool self_only = false;
+    
     enum {
       st_normal = 0,
       st_removed,
@@ -183,17 +237,246 @@ namespace art {
   namespace intern {
     extern const object::id_t first_object_id;
     
-    typedef std::multimap<real_t, event> events_by_depth_t;
-    extern std::map<event_type_t, events_by_depth_t> event_schedule;
-    extern std::deque<events_by_depth_t::iterator> events_pending_removal;
-    extern std::map<object::id_t, std::unique_ptr<object>> object_map;
-    
-    events_by_depth_t::iterator event_link(real_t, event&);
-    void event_unlink(events_by_depth_t::iterator&);
+    const std::size_t event_unlinked = static_cast<std::size_t>(-1);
+    
+    // A linked event together with the depth it was scheduled at. The owner and slot refer back to the entry in
+    // owner->linked_events which holds this event's index, so it can be patched whenever the list is reordered.
+    struct scheduled_event {
+      real_t depth;
+      object::index_t index;
+      object* owner;
+      std::size_t slot;
+      event ev;
+    };
+    
+    // Events of a single type, kept in a contiguous vector ordered by depth and then object_index, so consecutive
+    // calls tend to go to the same handler. Linking appends and unlinking leaves a tombstone, the list is only
+    // re-sorted when an append broke the order. Events linked while any list is being dispatched are staged in
+    // pending instead, so no list changes under a running phase. Pending events are sorted and merged in as one batch
+    // once the phase is over.
+    struct events_by_depth_t {
+      std::vector<scheduled_event> events;
+      std::vector<scheduled_event> pending;
+      std::size_t removed = 0;
+      unsigned dispatching = 0;
+      bool sorted = true;
+    };
+    
+    const std::size_t event_type_count = ev_keyrelease + 1;
+    extern std::array<events_by_depth_t, event_type_count> event_schedule;
+    
+    // Fixed size slots for the instances of a single object_index. Slots are carved out of slabs so instances of the
+    // same type sit next to each other, and destroyed slots go onto a free list to be handed out again.
+    struct object_pool {
+      static const std::size_t slots_per_slab = 64;
+      
+      std::size_t slot_size = 0;
+      std::vector<std::unique_ptr<unsigned char[]>> slabs;
+      std::vector<void*> free_slots;
+      
+      void* allocate();
+      void release(void*);
+    };
+    
+    typedef object* (*object_construct_t)(void*, object::id_t, real_t, real_t);
+    typedef void (*object_destruct_t)(object*);
+    
+    const object::index_t no_parent = static_cast<object::index_t>(-1);
+    
+    // Everything the runtime keeps per object_index. Instances are threaded onto an intrusive list in creation order
+    // which they only leave once released, so iterating it stays valid while instances are created or destroyed;
+    // count only includes instances that have not been destroyed.
+    //
+    // The family of a type is the type itself followed by all of its descendants, both as a list to iterate and as a
+    // mask over object indices to test membership with. Families are rebuilt lazily after registration changes.
+    //
+    // Event handlers are registered once per type rather than stored with every instance, and the generated class's
+    // destructor and create and destroy events are reached through plain function pointers instead of a vtable.
+    // Alarm events are not linked into the schedule but kept by alarm number, intern::alarms says when they are due.
+    // The positions of the draw events in events are listed separately, as they come and go with visibility.
+    struct object_type {
+      object_construct_t construct = nullptr;
+      object_destruct_t destruct = nullptr;
+      event::fn_t create = nullptr;
+      event::fn_t destroy = nullptr;
+      std::vector<event> events;
+      std::vector<std::size_t> draw_events;
+      std::array<event::fn_t, alarm_count> alarms = {{}};
+      object_pool pool;
+      object* first = nullptr;
+      object* last = nullptr;
+      std::size_t count = 0;
+      
+      object::index_t parent = no_parent;
+      std::vector<object::index_t> family;
+      std::vector<bool> family_mask;
+    };
+    
+    extern std::vector<object_type> object_types;
+    
+    object_type* object_type_from_index(object::index_t);
+    const std::vector<object::index_t>& object_family(object::index_t);
+    bool object_is_a(const object&, object::index_t);
+    
+    void object_register(object::index_t, std::size_t, object_construct_t, object::index_t);
+    
+    // Sets the events every instance of an object_index links, before the first one is created
+    void object_register_events(object::index_t, std::vector<event>);
+    
+    // Constructs an instance of a registered object_index under an id that was already handed out
+    object& object_create(object::index_t, object::id_t, real_t, real_t);
+    
+    // Generated object classes are registered with their object_index and parent, and must be constructible from
+    // (id, x, y) and define event_create and event_destroy.
+    template <typename T>
+    void object_register(object::index_t index, object::index_t parent = no_parent) {
+      object_register(index, sizeof(T), [](void* mem, object::id_t id, real_t x, real_t y) -> object* {
+        return new (mem) T(id, x, y);
+      }, parent);
+      object_type& type = object_types[index];
+      type.destruct = [](object* obj) {
+        static_cast<T*>(obj)->~T();
+      };
+      type.create = [](object& obj, const event::metadata_t) {
+        static_cast<T&>(obj).T::event_create();
+      };
+      type.destroy = [](object& obj, const event::metadata_t) {
+        static_cast<T&>(obj).T::event_destroy();
+      };
+    }
+    
+    // Maps instance ids to instances. Ids are never reused, so an id doubles as its own generation and the table is a
+    // page table indexed by id - base: resolving an id is a bounds check and two indexed loads. Destroyed instances
+    // leave a null slot, and compact() frees pages with no live instances left and drops leading ones entirely.
+    // Allocated pages are also listed by index, so walking every instance only visits pages that still hold some.
+    struct object_table {
+      static const std::size_t page_bits = 10;
+      static const std::size_t page_size = std::size_t(1) << page_bits;
+      
+      struct page {
+        std::array<object*, page_size> slots;
+        std::size_t live;
+      };
+      
+      object::id_t base;
+      std::vector<std::unique_ptr<page>> pages;
+      // Indices of the allocated pages in ascending order
+      std::vector<std::size_t> used;
+      
+      object* find(object::id_t id) const {
+        object::id_t offset = id - this->base;
+        if (id < this->base || (offset >> page_bits) >= this->pages.size()) {
+          return nullptr;
+        }
+        const page* p = this->pages[offset >> page_bits].get();
+        return p ? p->slots[offset & (page_size - 1)] : nullptr;
+      }
+      
+      void insert(object::id_t, object*);
+      void erase(object::id_t);
+      void compact();
+    };
+    
+    extern std::atomic<object::id_t> next_object_id;
+    extern object_table object_map;
+    extern std::vector<object*> objects_destroyed;
+    
+    // Built-in motion of every instance, stored as parallel arrays so the per-step update can run over all of them in
+    // one vectorised loop. Slots are kept dense: releasing one moves the last slot into the hole and repoints its
+    // owner. Friction is applied against the current direction of travel rather than stored per axis.
+    //
+    // Velocity is kept in both cartesian (hspeed, vspeed) and polar (speed, direction) form, but only the form that
+    // was last written is guaranteed current. The other one is marked stale and only derived when it is read, so
+    // setting hspeed and vspeed back to back costs no trigonometry at all.
+    struct motion_store {
+      enum sync_t : unsigned char {
+        synced,
+        polar_stale,
+        cartesian_stale
+      };
+      
+      std::vector<real_t> x;
+      std::vector<real_t> y;
+      std::vector<real_t> xprevious;
+      std::vector<real_t> yprevious;
+      std::vector<real_t> hspeed;
+      std::vector<real_t> vspeed;
+      std::vector<real_t> speed;
+      std::vector<real_t> direction;
+      std::vector<real_t> friction;
+      std::vector<real_t> hgravity;
+      std::vector<real_t> vgravity;
+      std::vector<unsigned char> sync;
+      std::vector<object*> owner;
+      
+      void derive_polar(std::size_t);
+      void derive_cartesian(std::size_t);
+      
+      void sync_polar(std::size_t slot) {
+        if (this->sync[slot] == polar_stale) {
+          this->derive_polar(slot);
+        }
+      }
+      
+      void sync_cartesian(std::size_t slot) {
+        if (this->sync[slot] == cartesian_stale) {
+          this->derive_cartesian(slot);
+        }
+      }
+      
+      std::size_t allocate(object&, real_t, real_t);
+      void release(std::size_t);
+      void copy(std::size_t, std::size_t);
+      
+      // Saves the previous position, applies friction and gravity and moves every instance by its speed.
+      void integrate();
+    };
+    
+    extern motion_store motion;
+    
+    // Destructs the instances destroyed since the last call, returns their slots to the pools and compacts the
+    // object map.
+    void objects_release();
+    
+    std::size_t event_link(object&, std::size_t);
+    void event_unlink(event_type_t, std::size_t);
+    void event_perform(event_type_t);
+    
+    // Brackets a pass over a list's events: brings it up to date and sorted on the way in. Leaving the outermost pass
+    // ends the phase and merges the events linked during it into every list.
+    void event_dispatch_begin(events_by_depth_t&);
+    void event_dispatch_end(events_by_depth_t&);
+    
+    // Sweeps tombstoned events out of every list in a single pass each and returns how many entries were reclaimed.
+    std::size_t event_schedule_compact();
+    
+    // Runs one game step, ending with the compaction phase.
+    void step();
     
     object& object_from_id(object::id_t);
     
-    typedef std::function<void(const object&)> with_fn_t;
+    // Stops with an error for a with target that names no instance or object. self is among them: with blocks on the
+    // current instance are compiled to use it directly, since the runtime does not track which instance that is.
+    void with_target_error(real_t);
+    
+    // The instance on the other side of the collision event currently being performed
+    extern object* other_instance;
+    
+    // Calls fn on every live instance of the type that existed when iteration started, counting each for the with
+    // profile
+    template <typename F>
+    void object_type_each(const object_type& type, F& fn) {
+      object* last = type.last;
+      for (object* obj = type.first; obj; obj = obj->_type_next) {
+        if (!obj->_destroyed) {
+          ART_PROFILE_WITH_VISIT();
+          fn(*obj);
+        }
+        if (obj == last) {
+          break;
+        }
+      }
+    }
   }
 
   enum {
@@ -203,12 +486,6 @@ namespace art {
     noone = -4,
   };
 
-  // Scoping
-  exposed void with(real_t, intern::with_fn_t);
-  exposed void with_objects_all(intern::with_fn_t);
-  exposed void with_objects_id(object::id_t, intern::with_fn_t);
-  exposed void with_objects_index(object::index_t, intern::with_fn_t);
-
   // Instances
   exposed real_t instance_create(real_t, real_t, real_t);
   exposed bool instance_exists(object::id_t);
@@ -216,8 +493,65 @@ namespace art {
   exposed real_t instance_furthest(real_t, real_t, real_t);
   exposed real_t instance_nearest(real_t, real_t, real_t);
   exposed real_t instance_number(real_t);
-  exposed real_t instance_place(real_t, real_t, real_t);
   exposed real_t instance_position(real_t, real_t, real_t);
+
+  // Scoping. These take the body of the with block by value so it is inlined into the loop over the instances.
+  template <typename F>
+  void with_objects_all(F fn) {
+    ART_PROFILE_WITH();
+    // Instances created by fn are not visited: their ids are past last, so their pages can only be listed after
+    // the current one and no page is freed until the next compact()
+    intern::object_table& table = intern::object_map;
+    object::id_t last = intern::next_object_id;
+    for (std::size_t n = 0; n < table.used.size(); ++n) {
+      std::size_t index = table.used[n];
+      object::id_t id = table.base + (object::id_t(index) << intern::object_table::page_bits);
+      for (std::size_t slot = 0; slot < intern::object_table::page_size && id < last; ++slot, ++id) {
+        if (object* obj = table.pages[index]->slots[slot]) {
+          ART_PROFILE_WITH_VISIT();
+          fn(*obj);
+        }
+      }
+    }
+  }
+  
+  template <typename F>
+  void with_objects_id(object::id_t id, F fn) {
+    ART_PROFILE_WITH();
+    ART_PROFILE_WITH_VISIT();
+    fn(intern::object_from_id(id));
+  }
+  
+  template <typename F>
+  void with_objects_index(object::index_t index, F fn) {
+    ART_PROFILE_WITH();
+    for (object::index_t member : intern::object_family(index)) {
+      intern::object_type_each(intern::object_types[member], fn);
+    }
+  }
+  
+  template <typename F>
+  void with(real_t num, F fn) {
+    switch(static_cast<long>(num)) {
+      case all:
+        return with_objects_all(fn);
+      case other:
+        if (intern::other_instance) {
+          ART_PROFILE_WITH();
+          ART_PROFILE_WITH_VISIT();
+          fn(*intern::other_instance);
+        }
+        return;
+      case noone:
+        return;
+      default:
+        if (num < 0) {
+          return intern::with_target_error(num);
+        }
+        return (num < intern::first_object_id) ?
+          with_objects_index(static_cast<object::index_t>(num), fn) : with_objects_id(static_cast<object::id_t>(num), fn);
+    }
+  }
 }
 
 #endif // ART_OBJECT_HPP_
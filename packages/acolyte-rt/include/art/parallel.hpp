@@ -0,0 +1,118 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_PARALLEL_HPP_
+#define ART_PARALLEL_HPP_
+
+#include "art/object.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace art {
+  namespace intern {
+    // Runs a job over a range of task indices on a fixed set of threads, the calling thread included. Every thread
+    // starts on its own contiguous share of the tasks and steals from the back of the others' once it runs dry.
+    struct thread_pool {
+      struct queue {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+      };
+
+      std::vector<std::thread> threads;
+      std::vector<std::unique_ptr<queue>> queues;
+      std::mutex lock;
+      std::condition_variable wake;
+      std::condition_variable done;
+      const std::function<void(std::size_t)>* job = nullptr;
+      std::size_t remaining = 0;
+      unsigned long round = 0;
+      bool stopping = false;
+
+      ~thread_pool();
+
+      // Total number of threads work is spread over, including the caller
+      std::size_t size() const {
+        return this->queues.size();
+      }
+
+      void start(std::size_t);
+      void stop();
+      void run(std::size_t, const std::function<void(std::size_t)>&);
+
+    private:
+      bool next(std::size_t, std::size_t&);
+      void work(std::size_t);
+      void loop(std::size_t);
+    };
+
+    // Changes recorded while events run on the pool, to be made once it is done. Buffers belong to a batch of events
+    // rather than a thread and are applied in batch order, so the outcome does not depend on scheduling.
+    struct command_buffer {
+      std::vector<std::function<void()>> commands;
+
+      void apply();
+    };
+
+    // The buffer of the batch the current thread is running, null when changes can be made directly
+    extern thread_local command_buffer* deferred_commands;
+
+    // Ids instance_create hands out inside a batch. Each batch owns one block of ids per round: round 0 has the
+    // blocks of every batch in batch order, and a batch that used up its block moves on to its own block in the next
+    // round. Ids then only depend on the events in each batch, never on which thread ran it or when.
+    struct batch_ids {
+      object::id_t base;
+      std::size_t batch;
+      std::size_t batches;
+      std::size_t block;
+      std::size_t used = 0;
+      // One past the highest id handed out, base when there was none
+      object::id_t end;
+      
+      batch_ids(object::id_t base, std::size_t batch, std::size_t batches, std::size_t block)
+        : base(base), batch(batch), batches(batches), block(block), end(base) {
+      }
+      
+      object::id_t next() {
+        std::size_t round = this->used / this->block;
+        object::id_t id = this->base + (round * this->batches + this->batch) * this->block + this->used % this->block;
+        ++this->used;
+        this->end = id + 1;
+        return id;
+      }
+    };
+    
+    // The ids of the batch the current thread is running, null when they are taken from next_object_id
+    extern thread_local batch_ids* deferred_ids;
+
+    // Stops with an error when called from a batch. Guards the queries that read other instances or update state
+    // shared by every instance, such as the collision grid and the nearest trees, which self-only events must not use.
+    void parallel_forbid(const char*);
+
+    // Records fn to run once the current batch is done, false if it should just be done now
+    inline bool defer(std::function<void()> fn) {
+      if (!deferred_commands) {
+        return false;
+      }
+      deferred_commands->commands.push_back(std::move(fn));
+      return true;
+    }
+
+    // Spreads self-only step events over the given number of threads, 0 or 1 runs everything on the calling thread.
+    void parallel_configure(std::size_t);
+    bool parallel_enabled();
+
+    // Runs fn for every task index on the pool. Without one, or from inside a batch, it runs them on the calling
+    // thread in order.
+    void parallel_for(std::size_t, const std::function<void(std::size_t)>&);
+
+    // Performs a list like event_perform, but runs each stretch of consecutive self-only events as batches on the
+    // pool. Other events run on the calling thread in between and act as barriers.
+    void event_perform_parallel(event_type_t);
+  }
+}
+
+#endif // ART_PARALLEL_HPP_
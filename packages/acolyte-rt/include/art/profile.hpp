@@ -0,0 +1,133 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_PROFILE_HPP_
+#define ART_PROFILE_HPP_
+
+#include "art/real.hpp"
+#include "art/string.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace art {
+  // Parts of a frame the profiler times separately
+  enum profile_phase_t {
+    ph_alarm,
+    ph_step,
+    ph_motion,
+    ph_collision,
+    ph_compact,
+    ph_release,
+    ph_draw,
+    ph_async
+  };
+  
+  namespace intern {
+    const std::size_t profile_phase_count = ph_async + 1;
+    
+    struct profile_stat {
+      std::uint64_t calls = 0;
+      std::uint64_t nanoseconds = 0;
+      std::uint64_t allocations = 0;
+      
+      void merge(const profile_stat&);
+    };
+    
+    // Everything recorded since the last reset. Event handlers are timed into the stats of both their event type and
+    // their object_index; with blocks count the instances they visit next to their own time.
+    struct profile_data {
+      std::vector<profile_stat> events;
+      std::vector<profile_stat> objects;
+      std::array<profile_stat, profile_phase_count> phases;
+      profile_stat with;
+      std::uint64_t with_instances = 0;
+      
+      profile_stat& event(std::size_t);
+      profile_stat& object(std::size_t);
+      void merge(const profile_data&);
+    };
+    
+    // A span of the Chrome trace, in nanoseconds since the profiler started
+    struct profile_span {
+      const char* name;
+      std::uint64_t start;
+      std::uint64_t duration;
+    };
+    
+#ifdef ACOLYTE_PROFILE
+    extern profile_data profile;
+    
+    // Where the current thread records to. Batches run on the thread pool each record into their own data, which is
+    // merged into profile once the batch is done, so times summed over a parallel phase are CPU time rather than wall
+    // time.
+    extern thread_local profile_data* profile_current;
+    
+    // Heap allocations made by the current thread. They are counted by replacing the global operator new, so a
+    // profiling build also counts allocations the host program makes outside the runtime.
+    extern thread_local std::uint64_t profile_allocations;
+    
+    extern bool profile_tracing;
+    extern std::vector<profile_span> profile_trace;
+    
+    std::uint64_t profile_clock();
+    
+    // Adds the time and allocations from construction to destruction to one stat, or two for event handlers. Named
+    // scopes on the main thread are also added to the trace while tracing.
+    struct profile_scope {
+      profile_stat& stat;
+      profile_stat* also;
+      const char* name;
+      std::uint64_t start;
+      std::uint64_t allocations;
+      
+      profile_scope(profile_stat& stat, profile_stat* also = nullptr, const char* name = nullptr)
+        : stat(stat), also(also), name(name), start(profile_clock()), allocations(profile_allocations) {
+      }
+
+      
+      ~profile_scope();
+    };
+    
+    extern const char* const profile_phase_names[profile_phase_count];
+
+#define ART_PROFILE_JOIN(a, b) a##b
+#define ART_PROFILE_SCOPE(line) ART_PROFILE_JOIN(profile_scope_, line)
+
+#define ART_PROFILE_PHASE(phase) \
+  ::art::intern::profile_scope ART_PROFILE_SCOPE(__LINE__)( \
+    ::art::intern::profile_current->phases[phase], nullptr, ::art::intern::profile_phase_names[phase])
+
+#define ART_PROFILE_EVENT(type, index) \
+  ::art::intern::profile_scope ART_PROFILE_SCOPE(__LINE__)( \
+    ::art::intern::profile_current->event(type), &::art::intern::profile_current->object(index))
+
+#define ART_PROFILE_WITH() \
+  ::art::intern::profile_scope ART_PROFILE_SCOPE(__LINE__)(::art::intern::profile_current->with)
+
+#define ART_PROFILE_WITH_VISIT() ++::art::intern::profile_current->with_instances
+#else
+#define ART_PROFILE_PHASE(phase)
+#define ART_PROFILE_EVENT(type, index)
+#define ART_PROFILE_WITH()
+#define ART_PROFILE_WITH_VISIT()
+#endif
+  }
+  
+  // Profiling. Times are in microseconds, everything reads 0 unless the runtime was built with ACOLYTE_PROFILE.
+  exposed void profile_reset();
+  exposed real_t profile_event_calls(real_t);
+  exposed real_t profile_event_time(real_t);
+  exposed real_t profile_object_calls(real_t);
+  exposed real_t profile_object_time(real_t);
+  exposed real_t profile_with_calls();
+  exposed real_t profile_with_instances();
+  exposed real_t profile_with_time();
+  exposed real_t profile_phase_time(real_t);
+  exposed real_t profile_phase_allocations(real_t);
+  exposed void profile_trace_start();
+  exposed real_t profile_trace_save(const string_t&);
+}
+
+#endif // ART_PROFILE_HPP_
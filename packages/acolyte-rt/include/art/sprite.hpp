@@ -0,0 +1,60 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#ifndef ART_SPRITE_HPP_
+#define ART_SPRITE_HPP_
+
+#include "art/real.hpp"
+
+#include <vector>
+
+namespace art {
+  namespace intern {
+    // Collision bounds in pixels relative to the sprite's top left corner, with right and bottom inclusive like GM's
+    // bbox variables.
+    struct sprite_bounds {
+      real_t bbox_left;
+      real_t bbox_top;
+      real_t bbox_right;
+      real_t bbox_bottom;
+    };
+    
+    // Size, origin and collision bounds of a sprite as exported by the compiler. Sprites with separate collision
+    // masks also list the bounds of each frame, bounds then covers all of them.
+    struct sprite_info {
+      real_t width;
+      real_t height;
+      real_t xoffset;
+      real_t yoffset;
+      sprite_bounds bounds;
+      real_t image_number;
+      std::vector<sprite_bounds> frames;
+      
+      // Collision bounds of the frame shown at image_index
+      const sprite_bounds& frame(real_t) const;
+    };
+    
+    extern std::vector<sprite_info> sprites;
+    extern std::vector<bool> sprites_defined;
+    
+    // Bumped whenever a sprite is registered, so bounding boxes cached from the old one are recomputed
+    extern unsigned long sprites_generation;
+    
+    void sprite_register(real_t, const sprite_info&);
+    const sprite_info* sprite_from_index(real_t);
+  }
+  
+  // Sprite Information
+  exposed real_t sprite_exists(real_t);
+  exposed real_t sprite_get_width(real_t);
+  exposed real_t sprite_get_height(real_t);
+  exposed real_t sprite_get_number(real_t);
+  exposed real_t sprite_get_xoffset(real_t);
+  exposed real_t sprite_get_yoffset(real_t);
+  exposed real_t sprite_get_bbox_left(real_t);
+  exposed real_t sprite_get_bbox_top(real_t);
+  exposed real_t sprite_get_bbox_right(real_t);
+  exposed real_t sprite_get_bbox_bottom(real_t);
+}
+
+#endif // ART_SPRITE_HPP_
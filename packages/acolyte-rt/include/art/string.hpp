@@ -7,14 +7,194 @@
 #include "art/real.hpp"
 #include "utf8.h"
 
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <ostream>
 #include <string>
 
 namespace art {
-  typedef std::string string_t;
+  // Immutable GML string. Strings of up to 15 bytes are kept inline, longer ones in a reference counted block shared
+  // by every copy, which also caches the string's hash. Copying a string therefore never copies its characters.
+  //
+  // The last of the 16 bytes says how the string is stored. Inline strings keep 15 - size there, which doubles as
+  // the terminator of a full inline buffer, shared strings keep shared_tag. Strings never use values from 0x40 up,
+  // so a type wrapping a string may keep its own tags in the same byte.
+  struct shared_string {
+    typedef char value_type;
+    typedef const char* const_iterator;
+    
+    static const std::size_t inline_capacity = 15;
+    static const unsigned char shared_tag = 0x20;
+    
+    shared_string() noexcept {
+      std::memset(this->bytes, 0, sizeof(this->bytes));
+      this->bytes[inline_capacity] = inline_capacity;
+    }
+    
+    shared_string(const char* str)
+      : shared_string(str, std::strlen(str)) {
+    }
+    
+    shared_string(const std::string& str)
+      : shared_string(str.data(), str.size()) {
+    }
+    
+    shared_string(const char*, std::size_t);
+    shared_string(std::size_t, char);
+    
+    shared_string(const shared_string& other) noexcept {
+      std::memcpy(this->bytes, other.bytes, sizeof(this->bytes));
+      if (this->is_shared()) {
+        this->block_ptr()->refs.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    
+    shared_string(shared_string&& other) noexcept {
+      std::memcpy(this->bytes, other.bytes, sizeof(this->bytes));
+      new (&other) shared_string();
+    }
+    
+    ~shared_string() {
+      if (this->is_shared()) {
+        release(this->block_ptr());
+      }
+    }
+    
+    shared_string& operator=(const shared_string& other) noexcept {
+      shared_string copy(other);
+      this->swap(copy);
+      return *this;
+    }
+    
+    shared_string& operator=(shared_string&& other) noexcept {
+      shared_string moved(std::move(other));
+      this->swap(moved);
+      return *this;
+    }
+    
+    void swap(shared_string& other) noexcept {
+      unsigned char temp[sizeof(this->bytes)];
+      std::memcpy(temp, this->bytes, sizeof(temp));
+      std::memcpy(this->bytes, other.bytes, sizeof(temp));
+      std::memcpy(other.bytes, temp, sizeof(temp));
+    }
+    
+    bool is_shared() const {
+      return this->bytes[inline_capacity] == shared_tag;
+    }
+    
+    std::size_t size() const {
+      return this->is_shared() ? this->block_ptr()->size : inline_capacity - this->bytes[inline_capacity];
+    }
+    
+    bool empty() const {
+      return !this->size();
+    }
+    
+    // Always null terminated
+    const char* data() const {
+      return this->is_shared() ? this->block_ptr()->chars() : reinterpret_cast<const char*>(this->bytes);
+    }
+    
+    const char* c_str() const {
+      return this->data();
+    }
+    
+    const_iterator begin() const {
+      return this->data();
+    }
+    
+    const_iterator end() const {
+      return this->data() + this->size();
+    }
+    
+    char operator[](std::size_t n) const {
+      return this->data()[n];
+    }
+    
+    std::string str() const {
+      return std::string(this->data(), this->size());
+    }
+    
+    // Byte-wise comparison, negative, zero or positive like std::string::compare
+    int compare(const shared_string&) const;
+    bool equals(const shared_string&) const;
+    std::size_t hash() const;
+    
+    friend shared_string operator+(const shared_string&, const shared_string&);
+    
+  private:
+    struct block {
+      std::atomic<unsigned long> refs;
+      std::size_t size;
+      mutable std::atomic<std::size_t> hash;
+      
+      char* chars() {
+        return reinterpret_cast<char*>(this + 1);
+      }
+    };
+    
+    static block* allocate(std::size_t);
+    static void release(block*);
+    
+    // Returns where size bytes of characters go, inline or in a new block
+    char* reserve(std::size_t);
+    
+    block* block_ptr() const {
+      block* ptr;
+      std::memcpy(&ptr, this->bytes, sizeof(ptr));
+      return ptr;
+    }
+    
+    alignas(block*) unsigned char bytes[16];
+  };
+  
+  typedef shared_string string_t;
+  
+  string_t operator+(const string_t&, const string_t&);
+  
+  inline bool operator==(const string_t& lhs, const string_t& rhs) {
+    return lhs.equals(rhs);
+  }
+  
+  inline bool operator!=(const string_t& lhs, const string_t& rhs) {
+    return !lhs.equals(rhs);
+  }
+  
+  inline bool operator<(const string_t& lhs, const string_t& rhs) {
+    return lhs.compare(rhs) < 0;
+  }
+  
+  inline bool operator<=(const string_t& lhs, const string_t& rhs) {
+    return lhs.compare(rhs) <= 0;
+  }
+  
+  inline bool operator>(const string_t& lhs, const string_t& rhs) {
+    return lhs.compare(rhs) > 0;
+  }
+  
+  inline bool operator>=(const string_t& lhs, const string_t& rhs) {
+    return lhs.compare(rhs) >= 0;
+  }
+  
+  inline std::ostream& operator<<(std::ostream& out, const string_t& str) {
+    return out.write(str.data(), str.size());
+  }
 
   //string_t ansi_char(real_t);
   //string_t chr(real_t val);
   //real_t ord(string_t str);
 }
 
+namespace std {
+  template <>
+  struct hash<art::shared_string> {
+    size_t operator()(const art::shared_string& str) const {
+      return str.hash();
+    }
+  };
+}
+
 #endif // ART_STRING_HPP_
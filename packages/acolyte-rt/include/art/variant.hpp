@@ -7,40 +7,170 @@
 #include "art/real.hpp"
 #include "art/string.hpp"
 
+#include <cstring>
+#include <new>
+#include <utility>
+
 namespace art {
+  // A real or a string in 16 bytes. The two share storage: a string occupies all of it, a real the first 8 bytes.
+  // The last byte is the string's own storage byte, which strings never set to 0x40 or above, so reals and
+  // uninitialised variants are told apart from strings by tags in that range. Copying anything but a shared string
+  // is a plain 16 byte copy.
   struct variant {
-    variant() = default;
-    variant(real_t);
-    variant(string_t);
-    variant(variant const &) = default;
-    variant(variant &&);
-
-    variant& operator=(variant const &) = default;
-    variant& operator=(variant &&);
-    
-    bool operator<(variant const &) const;
-    bool operator<=(variant const &) const;
-    bool operator>(variant const &) const;
-    bool operator>=(variant const &) const;
-
-    operator real_t() const;
-    operator string_t() const;
-    operator bool() const;
-    
     enum type_t {
       vt_uninit = 0,
       vt_real,
       vt_string
-    } type = vt_uninit;
+    };
+    
+    variant() {
+      this->bytes[tag_byte] = uninit_tag;
+    }
+    
+    variant(real_t val) {
+      std::memcpy(this->bytes, &val, sizeof(val));
+      this->bytes[tag_byte] = real_tag;
+    }
+    
+    variant(string_t val) {
+      new (this->bytes) string_t(std::move(val));
+    }
+    
+    variant(const variant& rhs) {
+      if (rhs.type() == vt_string) {
+        new (this->bytes) string_t(rhs.string());
+      } else {
+        std::memcpy(this->bytes, rhs.bytes, sizeof(this->bytes));
+      }
+    }
+    
+    variant(variant&& rhs) {
+      std::memcpy(this->bytes, rhs.bytes, sizeof(this->bytes));
+      rhs.bytes[tag_byte] = uninit_tag;
+    }
+    
+    ~variant() {
+      this->clear();
+    }
+    
+    variant& operator=(const variant& rhs) {
+      if (this != &rhs) {
+        variant copy(rhs);
+        this->clear();
+        std::memcpy(this->bytes, copy.bytes, sizeof(this->bytes));
+        copy.bytes[tag_byte] = uninit_tag;
+      }
+      return *this;
+    }
+    
+    variant& operator=(variant&&);
+    
+    // Negative, zero or positive as this orders before, with or after rhs. Reals are compared directly, strings
+    // byte-wise, and ordering a real against a string is an error.
+    int compare(const variant& rhs) const {
+      if (this->bytes[tag_byte] == real_tag && rhs.bytes[tag_byte] == real_tag) {
+        real_t lhs = this->real(), other = rhs.real();
+        return (lhs > other) - (lhs < other);
+      }
+      return this->compare_strings(rhs);
+    }
+    
+    // Unlike the ordering, a real and a string are simply unequal, so variants of either type can share a container
+    bool equals(const variant& rhs) const {
+      if (this->bytes[tag_byte] == real_tag) {
+        return rhs.bytes[tag_byte] == real_tag && this->real() == rhs.real();
+      }
+      return this->type() == vt_string && rhs.type() == vt_string && this->string().equals(rhs.string());
+    }
+    
+    // Consistent with equals, strings reuse the hash cached in their shared block
+    std::size_t hash() const;
+    
+    bool operator==(const variant& rhs) const {
+      return this->equals(rhs);
+    }
+    
+    bool operator!=(const variant& rhs) const {
+      return !this->equals(rhs);
+    }
+    
+    bool operator<(const variant& rhs) const {
+      return this->compare(rhs) < 0;
+    }
     
-    real_t real;
-    string_t string;
+    bool operator<=(const variant& rhs) const {
+      return this->compare(rhs) <= 0;
+    }
+    
+    bool operator>(const variant& rhs) const {
+      return this->compare(rhs) > 0;
+    }
+    
+    bool operator>=(const variant& rhs) const {
+      return this->compare(rhs) >= 0;
+    }
+
+    // Each conversion checks the tag with a single comparison
+    operator real_t() const {
+      if (this->bytes[tag_byte] != real_tag) {
+        this->type_error(vt_real);
+      }
+      return this->real();
+    }
+    
+    operator string_t() const {
+      if (this->bytes[tag_byte] >= real_tag) {
+        this->type_error(vt_string);
+      }
+      return this->string();
+    }
+    
+    operator bool() const;
+    
+    type_t type() const {
+      unsigned char tag = this->bytes[tag_byte];
+      return (tag < real_tag) ? vt_string : (tag == real_tag) ? vt_real : vt_uninit;
+    }
+    
+    // Unchecked access to the value, for callers that have already looked at type()
+    real_t real() const {
+      real_t val;
+      std::memcpy(&val, this->bytes, sizeof(val));
+      return val;
+    }
+    
+    const string_t& string() const {
+      return *reinterpret_cast<const string_t*>(this->bytes);
+    }
+    
+  private:
+    static const std::size_t tag_byte = sizeof(string_t) - 1;
+    static const unsigned char real_tag = 0x40;
+    static const unsigned char uninit_tag = 0x41;
+    
+    // Reports a variant read as the wrong type, or read before it was assigned, and aborts
+    [[noreturn]] void type_error(type_t) const;
+    
+    int compare_strings(const variant&) const;
+    
+    void clear() {
+      if (this->type() == vt_string) {
+        reinterpret_cast<string_t*>(this->bytes)->~string_t();
+      }
+    }
+    
+    alignas(string_t) unsigned char bytes[sizeof(string_t)];
   };
   
   typedef variant variant_t;
   
   namespace intern {
+    // Locale independent conversions. Reals are written with a fixed number of decimals, strings are read from their
+    // leading number, which may be signed and have a fraction and exponent. Reals are rounded half to even from their
+    // exact value, like printf does. Text without a leading number reads as 0, and number is set to whether there
+    // was one; real() treats that as an error.
     string_t real_to_string(real_t, unsigned);
+    real_t string_to_real(const string_t&, bool* number = nullptr);
   }
 
   real_t is_real(const variant_t&);
@@ -49,4 +179,13 @@ namespace art {
   string_t string(variant_t var);
 }
 
+namespace std {
+  template <>
+  struct hash<art::variant> {
+    size_t operator()(const art::variant& var) const {
+      return var.hash();
+    }
+  };
+}
+
 #endif // ART_VARIANT_HPP_
@@ -0,0 +1,80 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/alarm.hpp"
+
+#include <algorithm>
+
+namespace art {
+  namespace intern {
+    alarm_wheel alarms;
+    
+    namespace {
+      std::vector<alarm_wheel::entry> alarms_due;
+    }
+    
+    void alarm_wheel::schedule(const entry& e) {
+      std::uint64_t delta = e.deadline - this->now;
+      for (std::size_t level = 0; level < level_count; ++level) {
+        if (delta < span(level + 1)) {
+          this->levels[level][(e.deadline >> (slot_bits * level)) & (slot_count - 1)].push_back(e);
+          return;
+        }
+      }
+      this->overflow.push_back(e);
+    }
+    
+    void alarm_wheel::advance(std::vector<entry>& due) {
+      ++this->now;
+      
+      // A slot of level n comes up once the step is a multiple of span(n). Cascading starts at the outermost one so
+      // entries can fall through several levels in one go.
+      std::size_t top = 0;
+      while (top + 1 < level_count && !(this->now % span(top + 1))) {
+        ++top;
+      }
+      if (!(this->now % span(level_count))) {
+        std::vector<entry> waiting;
+        waiting.swap(this->overflow);
+        for (const entry& e : waiting) {
+          this->schedule(e);
+        }
+      }
+      for (std::size_t level = top; level > 0; --level) {
+        std::vector<entry> slot;
+        slot.swap(this->levels[level][(this->now >> (slot_bits * level)) & (slot_count - 1)]);
+        for (const entry& e : slot) {
+          this->schedule(e);
+        }
+      }
+      
+      std::vector<entry>& slot = this->levels[0][this->now & (slot_count - 1)];
+      due.insert(due.end(), slot.begin(), slot.end());
+      slot.clear();
+    }
+    
+    void alarms_perform() {
+      alarms_due.clear();
+      alarms.advance(alarms_due);
+      if (alarms_due.empty()) {
+        return;
+      }
+      
+      std::sort(alarms_due.begin(), alarms_due.end(), [](const alarm_wheel::entry& lhs, const alarm_wheel::entry& rhs) {
+        return lhs.id < rhs.id || (lhs.id == rhs.id && lhs.n < rhs.n);
+      });
+      for (const alarm_wheel::entry& e : alarms_due) {
+        object* obj = object_map.find(e.id);
+        if (!obj || obj->_destroyed || obj->_alarm[e.n] != e.deadline) {
+          continue;
+        }
+        // Cleared first, so the event is free to set the alarm again
+        obj->_alarm[e.n] = 0;
+        if (event::fn_t fn = object_types[obj->_index].alarms[e.n]) {
+          ART_PROFILE_EVENT(ev_alarm, obj->_index);
+          fn(*obj, e.n);
+        }
+      }
+    }
+  }
+}
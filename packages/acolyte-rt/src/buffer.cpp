@@ -0,0 +1,938 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ART_BUFFER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace art {
+  exposed const unsigned buffer_fixed = intern::bm_fixed;
+  exposed const unsigned buffer_grow = intern::bm_grow;
+  exposed const unsigned buffer_wrap = intern::bm_wrap;
+  exposed const unsigned buffer_fast = intern::bm_fast;
+
+  exposed const unsigned buffer_u8 = intern::bt_u8;
+  exposed const unsigned buffer_s8 = intern::bt_s8;
+  exposed const unsigned buffer_u16 = intern::bt_u16;
+  exposed const unsigned buffer_s16 = intern::bt_s16;
+  exposed const unsigned buffer_u32 = intern::bt_u32;
+  exposed const unsigned buffer_s32 = intern::bt_s32;
+  exposed const unsigned buffer_f16 = intern::bt_f16;
+  exposed const unsigned buffer_f32 = intern::bt_f32;
+  exposed const unsigned buffer_f64 = intern::bt_f64;
+  exposed const unsigned buffer_bool = intern::bt_bool;
+  exposed const unsigned buffer_string = intern::bt_string;
+
+  exposed const unsigned buffer_seek_start = 0;
+  exposed const unsigned buffer_seek_relative = 1;
+  exposed const unsigned buffer_seek_end = 2;
+
+  namespace intern {
+    decltype(buffers) buffers;
+
+    namespace {
+      std::size_t to_size(real_t val) {
+        return (val > 0) ? static_cast<std::size_t>(val) : 0;
+      }
+
+      std::size_t align_up(std::size_t pos, std::size_t alignment) {
+        return (pos + alignment - 1) & ~(alignment - 1);
+      }
+
+      buffer_type_t buffer_type_from(real_t type) {
+        if (type < bt_u8 || type > bt_string) {
+          std::cerr << "error: buffer data type does not exist" << std::endl;
+          std::abort();
+        }
+        return static_cast<buffer_type_t>(static_cast<unsigned>(type));
+      }
+
+      template <typename T>
+      T load(const unsigned char* p) {
+        T val;
+        std::memcpy(&val, p, sizeof(val));
+        return val;
+      }
+
+      template <typename T>
+      void store(unsigned char* p, T val) {
+        std::memcpy(p, &val, sizeof(val));
+      }
+
+      // Integers wrap around like a cast in C, fractions are dropped. Casting is only defined within the range of a
+      // 64 bit integer, so NaN is written as 0 and anything beyond that range, infinities included, as the nearest
+      // end of the type's own range.
+      template <typename T>
+      void store_integer(unsigned char* p, real_t val) {
+        const real_t limit = 9223372036854775808.0;
+        if (val != val) {
+          store(p, T(0));
+        } else if (val >= limit) {
+          store(p, std::numeric_limits<T>::max());
+        } else if (val < -limit) {
+          store(p, std::numeric_limits<T>::min());
+        } else {
+          store(p, static_cast<T>(static_cast<std::int64_t>(val)));
+        }
+      }
+
+      // IEEE half precision, rounding to the nearest even like a hardware conversion
+      std::uint16_t half_from_float(float val) {
+        std::uint32_t bits = load<std::uint32_t>(reinterpret_cast<const unsigned char*>(&val));
+        std::uint32_t sign = (bits >> 16) & 0x8000;
+        std::uint32_t mantissa = bits & 0x7fffff;
+        int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+        if (((bits >> 23) & 0xff) == 0xff) {
+          return static_cast<std::uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        }
+        if (exponent >= 31) {
+          return static_cast<std::uint16_t>(sign | 0x7c00);
+        }
+
+        std::uint32_t half, rest, midpoint;
+        if (exponent <= 0) {
+          if (exponent < -10) {
+            return static_cast<std::uint16_t>(sign);
+          }
+          // Too small for a normal half, the implicit leading bit becomes part of a subnormal mantissa
+          mantissa |= 0x800000;
+          unsigned shift = static_cast<unsigned>(14 - exponent);
+          half = mantissa >> shift;
+          rest = mantissa & ((1u << shift) - 1);
+          midpoint = 1u << (shift - 1);
+        } else {
+          half = (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13);
+          rest = mantissa & 0x1fff;
+          midpoint = 0x1000;
+        }
+        // Rounding up may carry into the exponent, which gives the right result up to infinity
+        if (rest > midpoint || (rest == midpoint && (half & 1))) {
+          ++half;
+        }
+        return static_cast<std::uint16_t>(sign | half);
+      }
+
+      float float_from_half(std::uint16_t half) {
+        std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000) << 16;
+        std::uint32_t exponent = (half >> 10) & 0x1f;
+        std::uint32_t mantissa = half & 0x3ff;
+        if (!exponent) {
+          float val = std::ldexp(static_cast<float>(mantissa), -24);
+          return sign ? -val : val;
+        }
+        std::uint32_t bits = sign | (mantissa << 13);
+        bits |= (exponent == 31) ? 0x7f800000 : (exponent + 112) << 23;
+        return load<float>(reinterpret_cast<const unsigned char*>(&bits));
+      }
+
+      // The bytes from offset to offset + size, cut short at the end of the buffer
+      const unsigned char* buffer_range(real_t index, real_t offset, real_t size, std::size_t& count) {
+        buffer& buf = buffer_from_index(index);
+        std::size_t first = std::min(to_size(offset), buf.size);
+        count = std::min(to_size(size), buf.size - first);
+        return buf.data + first;
+      }
+
+      // Feeds a message to a 64 byte block function followed by the padding MD5 and SHA-1 share, which ends with the
+      // length in bits in the given byte order.
+      template <typename Block>
+      void hash_blocks(const unsigned char* data, std::size_t size, bool big_endian, Block block) {
+        std::size_t n = 0;
+        for (; n + 64 <= size; n += 64) {
+          block(data + n);
+        }
+        unsigned char tail[128] = {};
+        std::size_t rest = size - n;
+        if (rest) {
+          std::memcpy(tail, data + n, rest);
+        }
+        tail[rest] = 0x80;
+        std::size_t blocks = (rest + 9 > 64) ? 2 : 1;
+        std::uint64_t bits = static_cast<std::uint64_t>(size) * 8;
+        for (std::size_t i = 0; i < 8; ++i) {
+          tail[blocks * 64 - 8 + i] = static_cast<unsigned char>(bits >> (big_endian ? 56 - 8 * i : 8 * i));
+        }
+        for (std::size_t i = 0; i < blocks; ++i) {
+          block(tail + i * 64);
+        }
+      }
+
+      std::uint32_t rotate_left(std::uint32_t val, unsigned n) {
+        return (val << n) | (val >> (32 - n));
+      }
+
+      string_t hex_string(const unsigned char* digest, std::size_t size) {
+        const char digits[] = "0123456789abcdef";
+        char out[40];
+        for (std::size_t n = 0; n < size; ++n) {
+          out[2 * n] = digits[digest[n] >> 4];
+          out[2 * n + 1] = digits[digest[n] & 0xf];
+        }
+        return string_t(out, 2 * size);
+      }
+
+      const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+      buffer* buffer_find(real_t index) {
+        if (index < 0 || index >= buffers.size()) {
+          return nullptr;
+        }
+        return buffers[static_cast<std::size_t>(index)].get();
+      }
+
+      bool write_file(const string_t& path, const unsigned char* data, std::size_t size) {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+      }
+
+      // Size of a file opened at its end, false when the stream cannot tell
+      bool file_size(std::ifstream& file, std::size_t& size) {
+        std::streamoff end = file.tellg();
+        if (end < 0) {
+          return false;
+        }
+        size = static_cast<std::size_t>(end);
+        return true;
+      }
+      
+      // Reads exactly size bytes from the start of a file, false when it ends early or fails
+      bool read_bytes(std::ifstream& file, unsigned char* data, std::size_t size) {
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+        return file && static_cast<std::size_t>(file.gcount()) == size;
+      }
+
+      // Reads up to limit bytes from the start of a file, all of it when limit is negative
+      bool read_file(const string_t& path, real_t limit, std::vector<unsigned char>& data) {
+        std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!file) {
+          return false;
+        }
+        std::size_t size;
+        if (!file_size(file, size)) {
+          return false;
+        }
+        data.resize((limit < 0) ? size : std::min(size, to_size(limit)));
+        return read_bytes(file, data.data(), data.size());
+      }
+
+#ifdef ART_BUFFER_MMAP
+      // A new grow buffer over a private mapping of the file, or -1 when it is too small to be worth mapping or
+      // cannot be mapped
+      real_t buffer_map(const string_t& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+          return -1;
+        }
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (!::fstat(fd, &info) && static_cast<std::size_t>(info.st_size) >= buffer_mapping_threshold) {
+          mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+          return -1;
+        }
+
+        real_t index = buffer_create(0, bm_grow, 1);
+        buffer& buf = buffer_from_index(index);
+        buf.mapping = mapping;
+        buf.mapping_size = static_cast<std::size_t>(info.st_size);
+        buf.data = static_cast<unsigned char*>(mapping);
+        buf.size = buf.capacity = buf.mapping_size;
+        return index;
+      }
+#endif
+
+      struct async_request {
+        real_t id;
+        real_t buffer;
+        unsigned long generation;
+        string_t path;
+        bool save;
+        std::size_t offset;
+        real_t size;
+        std::vector<unsigned char> data;
+        bool succeeded;
+      };
+
+      // Runs requests one at a time on a thread started by the first of them. Saves carry a copy of their bytes and
+      // loads read into their own, so the thread never touches a buffer. Requests still queued at exit are finished
+      // first, so no save is lost.
+      struct async_io {
+        std::thread thread;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::deque<async_request> queued;
+        std::vector<async_request> finished;
+        bool stopping = false;
+
+        ~async_io() {
+          {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->stopping = true;
+          }
+          this->wake.notify_all();
+          if (this->thread.joinable()) {
+            this->thread.join();
+          }
+        }
+
+        void submit(async_request request) {
+          {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (!this->thread.joinable()) {
+              this->thread = std::thread(&async_io::loop, this);
+            }
+            this->queued.push_back(std::move(request));
+          }
+          this->wake.notify_all();
+        }
+
+        void loop() {
+          for (;;) {
+            async_request request;
+            {
+              std::unique_lock<std::mutex> guard(this->lock);
+              this->wake.wait(guard, [this] { return this->stopping || !this->queued.empty(); });
+              if (this->queued.empty()) {
+                return;
+              }
+              request = std::move(this->queued.front());
+              this->queued.pop_front();
+            }
+            if (request.save) {
+              request.succeeded = write_file(request.path, request.data.data(), request.data.size());
+            } else {
+              request.succeeded = read_file(request.path, request.size, request.data);
+            }
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->finished.push_back(std::move(request));
+          }
+        }
+      };
+
+      async_io io;
+      unsigned long buffer_generations = 0;
+      real_t async_next_id = 0;
+      real_t async_current_id = -1;
+      bool async_current_status = false;
+
+      // Copies what a finished load read into its buffer, false if the buffer is gone, even when another one has taken
+      // its index since, or the bytes do not fit
+      bool async_complete_load(const async_request& request) {
+        buffer* buf = buffer_find(request.buffer);
+        if (!buf || buf->generation != request.generation) {
+          return false;
+        }
+        std::size_t end = request.offset + request.data.size();
+        if (end > buf->size && buf->mode == bm_grow) {
+          buf->resize(end);
+        }
+        if (end > buf->size) {
+          return false;
+        }
+        if (!request.data.empty()) {
+          std::memcpy(buf->data + request.offset, request.data.data(), request.data.size());
+        }
+        return true;
+      }
+
+      // The next free index, reusing the lowest one a deleted buffer left
+      std::size_t buffer_slot() {
+        auto it = std::find(buffers.begin(), buffers.end(), nullptr);
+        if (it == buffers.end()) {
+          buffers.emplace_back();
+          return buffers.size() - 1;
+        }
+        return static_cast<std::size_t>(it - buffers.begin());
+      }
+    }
+
+    buffer::buffer(std::size_t size, buffer_mode_t mode, std::size_t alignment)
+      : alignment(alignment), mode(mode), generation(++buffer_generations) {
+      this->resize(size);
+    }
+
+    buffer::~buffer() {
+#ifdef ART_BUFFER_MMAP
+      if (this->mapping) {
+        ::munmap(this->mapping, this->mapping_size);
+      }
+#endif
+    }
+
+    void buffer::resize(std::size_t size) {
+      if (size > this->capacity) {
+        std::size_t capacity = std::max(size, this->capacity * 2);
+        std::unique_ptr<unsigned char[]> storage(new unsigned char[capacity + this->alignment - 1]);
+        auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+        unsigned char* data = storage.get() + (this->alignment - address % this->alignment) % this->alignment;
+        if (this->size) {
+          std::memcpy(data, this->data, this->size);
+        }
+        this->storage = std::move(storage);
+        this->data = data;
+        this->capacity = capacity;
+#ifdef ART_BUFFER_MMAP
+        if (this->mapping) {
+          ::munmap(this->mapping, this->mapping_size);
+          this->mapping = nullptr;
+          this->mapping_size = 0;
+        }
+#endif
+      }
+      if (size > this->size) {
+        std::memset(this->data + this->size, 0, size - this->size);
+      }
+      this->size = size;
+      this->pos = std::min(this->pos, size);
+    }
+
+    unsigned char* buffer::advance(std::size_t n, bool writing) {
+      std::size_t start = align_up(this->pos, this->alignment);
+      if (start + n > this->size) {
+        if (this->mode == bm_grow && writing) {
+          this->resize(start + n);
+        } else if (this->mode == bm_wrap && n <= this->size) {
+          start = 0;
+        } else {
+          return nullptr;
+        }
+      }
+      this->pos = start + n;
+      return this->data + start;
+    }
+
+    buffer& buffer_from_index(real_t index) {
+      buffer* buf = buffer_find(index);
+      if (!buf) {
+        std::cerr << "error: buffer does not exist" << std::endl;
+        std::abort();
+      }
+      return *buf;
+    }
+
+    std::size_t buffer_type_size(buffer_type_t type) {
+      switch (type) {
+        case bt_u8:
+        case bt_s8:
+        case bt_bool:
+          return 1;
+        case bt_u16:
+        case bt_s16:
+        case bt_f16:
+          return 2;
+        case bt_u32:
+        case bt_s32:
+        case bt_f32:
+          return 4;
+        case bt_f64:
+          return 8;
+        case bt_string:
+          break;
+      }
+      return 0;
+    }
+
+    std::size_t buffer_value_size(buffer_type_t type, const variant_t& val) {
+      if (type == bt_string) {
+        return static_cast<string_t>(val).size() + 1;
+      }
+      return buffer_type_size(type);
+    }
+
+    variant_t buffer_load_value(const unsigned char* p, std::size_t size, buffer_type_t type) {
+      switch (type) {
+        case bt_u8:
+          return static_cast<real_t>(*p);
+        case bt_s8:
+          return static_cast<real_t>(load<std::int8_t>(p));
+        case bt_u16:
+          return static_cast<real_t>(load<std::uint16_t>(p));
+        case bt_s16:
+          return static_cast<real_t>(load<std::int16_t>(p));
+        case bt_u32:
+          return static_cast<real_t>(load<std::uint32_t>(p));
+        case bt_s32:
+          return static_cast<real_t>(load<std::int32_t>(p));
+        case bt_f16:
+          return static_cast<real_t>(float_from_half(load<std::uint16_t>(p)));
+        case bt_f32:
+          return static_cast<real_t>(load<float>(p));
+        case bt_f64:
+          return load<real_t>(p);
+        case bt_bool:
+          return static_cast<real_t>(*p != 0);
+        case bt_string:
+          break;
+      }
+      auto end = static_cast<const unsigned char*>(std::memchr(p, 0, size));
+      return string_t(reinterpret_cast<const char*>(p), end ? static_cast<std::size_t>(end - p) : size);
+    }
+
+    void buffer_store_value(unsigned char* p, buffer_type_t type, const variant_t& val) {
+      if (type == bt_string) {
+        string_t str = val;
+        std::memcpy(p, str.data(), str.size());
+        p[str.size()] = 0;
+        return;
+      }
+      real_t num = val;
+      switch (type) {
+        case bt_u8:
+          return store_integer<std::uint8_t>(p, num);
+        case bt_s8:
+          return store_integer<std::int8_t>(p, num);
+        case bt_u16:
+          return store_integer<std::uint16_t>(p, num);
+        case bt_s16:
+          return store_integer<std::int16_t>(p, num);
+        case bt_u32:
+          return store_integer<std::uint32_t>(p, num);
+        case bt_s32:
+          return store_integer<std::int32_t>(p, num);
+        case bt_f16:
+          return store(p, half_from_float(static_cast<float>(num)));
+        case bt_f32:
+          return store(p, static_cast<float>(num));
+        case bt_f64:
+          return store(p, num);
+        case bt_bool:
+          return store<std::uint8_t>(p, num > 0.5);
+        case bt_string:
+          break;
+      }
+    }
+
+    void buffer_async_perform() {
+      std::vector<async_request> done;
+      {
+        std::lock_guard<std::mutex> guard(io.lock);
+        done.swap(io.finished);
+      }
+      for (const async_request& request : done) {
+        async_current_id = request.id;
+        async_current_status = request.succeeded && (request.save || async_complete_load(request));
+
+        auto& list = event_schedule[ev_other];
+        event_dispatch_begin(list);
+        for (std::size_t i = 0; i < list.events.size(); ++i) {
+          const event& ev = list.events[i].ev;
+          if (ev.status == event::st_normal && ev.metadata == ev_async_save_load) {
+            ART_PROFILE_EVENT(ev_other, list.events[i].index);
+            ev.fn(*list.events[i].owner, ev.metadata);
+          }
+        }
+        event_dispatch_end(list);
+      }
+      async_current_id = -1;
+    }
+  }
+
+  real_t buffer_create(real_t size, real_t mode, real_t alignment) {
+    if (mode < intern::bm_fixed || mode > intern::bm_fast) {
+      std::cerr << "error: buffer type does not exist" << std::endl;
+      std::abort();
+    }
+    std::size_t align = intern::to_size(alignment);
+    if (!align || (align & (align - 1))) {
+      std::cerr << "error: buffer alignment must be a power of two" << std::endl;
+      std::abort();
+    }
+    auto type = static_cast<intern::buffer_mode_t>(static_cast<unsigned>(mode));
+    std::size_t index = intern::buffer_slot();
+    intern::buffers[index].reset(new intern::buffer(intern::to_size(size), type, (type == intern::bm_fast) ? 1 : align));
+    return static_cast<real_t>(index);
+  }
+
+  real_t buffer_delete(real_t index) {
+    intern::buffer_from_index(index);
+    intern::buffers[static_cast<std::size_t>(index)].reset();
+    return 0;
+  }
+
+  variant_t buffer_read(real_t index, real_t type) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    // Fast buffers only hold bytes, so the type is not looked at
+    if (buf.mode == intern::bm_fast) {
+      return static_cast<real_t>((buf.pos < buf.size) ? buf.data[buf.pos++] : 0);
+    }
+
+    intern::buffer_type_t t = intern::buffer_type_from(type);
+    if (t == intern::bt_string) {
+      std::size_t start = intern::align_up(buf.pos, buf.alignment);
+      if (start >= buf.size) {
+        return string_t();
+      }
+      variant_t str = intern::buffer_load_value(buf.data + start, buf.size - start, t);
+      buf.pos = std::min(start + str.string().size() + 1, buf.size);
+      return str;
+    }
+    const unsigned char* p = buf.advance(intern::buffer_type_size(t), false);
+    return p ? intern::buffer_load_value(p, 0, t) : variant_t(0.0);
+  }
+
+  real_t buffer_write(real_t index, real_t type, const variant_t& val) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    if (buf.mode == intern::bm_fast) {
+      if (buf.pos >= buf.size) {
+        return -1;
+      }
+      buf.data[buf.pos++] = static_cast<unsigned char>(static_cast<std::int64_t>(static_cast<real_t>(val)));
+      return 0;
+    }
+
+    intern::buffer_type_t t = intern::buffer_type_from(type);
+    unsigned char* p = buf.advance(intern::buffer_value_size(t, val), true);
+    if (!p) {
+      return -1;
+    }
+    intern::buffer_store_value(p, t, val);
+    return 0;
+  }
+
+  real_t buffer_fill(real_t index, real_t offset, real_t type, const variant_t& val, real_t size) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    intern::buffer_type_t t = intern::buffer_type_from(type);
+
+    // The value is encoded once and copied into every aligned slot that fits whole
+    std::size_t n = intern::buffer_value_size(t, val);
+    std::vector<unsigned char> encoded(n);
+    intern::buffer_store_value(encoded.data(), t, val);
+    std::size_t first = intern::to_size(offset);
+    std::size_t end = std::min(first + intern::to_size(size), buf.size);
+    for (std::size_t pos = intern::align_up(first, buf.alignment); pos + n <= end; pos = intern::align_up(pos + n, buf.alignment)) {
+      std::memcpy(buf.data + pos, encoded.data(), n);
+    }
+    return 0;
+  }
+
+  real_t buffer_seek(real_t index, real_t base, real_t offset) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    real_t from = (base == buffer_seek_relative) ? buf.pos : (base == buffer_seek_end) ? buf.size : 0;
+    real_t pos = from + std::floor(offset);
+    if (buf.mode == intern::bm_wrap && buf.size) {
+      pos -= std::floor(pos / buf.size) * buf.size;
+    }
+    buf.pos = std::min(intern::to_size(pos), buf.size);
+    return 0;
+  }
+
+  real_t buffer_tell(real_t index) {
+    return static_cast<real_t>(intern::buffer_from_index(index).pos);
+  }
+
+  variant_t buffer_peek(real_t index, real_t offset, real_t type) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    intern::buffer_type_t t = intern::buffer_type_from(type);
+    std::size_t pos = intern::to_size(offset);
+    if (offset < 0 || pos + std::max<std::size_t>(intern::buffer_type_size(t), 1) > buf.size) {
+      return (t == intern::bt_string) ? variant_t(string_t()) : variant_t(0.0);
+    }
+    return intern::buffer_load_value(buf.data + pos, buf.size - pos, t);
+  }
+
+  real_t buffer_poke(real_t index, real_t offset, real_t type, const variant_t& val) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    intern::buffer_type_t t = intern::buffer_type_from(type);
+    std::size_t pos = intern::to_size(offset);
+    if (offset < 0 || pos + intern::buffer_value_size(t, val) > buf.size) {
+      return -1;
+    }
+    intern::buffer_store_value(buf.data + pos, t, val);
+    return 0;
+  }
+
+  real_t buffer_save(real_t index, const string_t& path) {
+    return buffer_save_ext(index, path, 0, intern::buffer_from_index(index).size);
+  }
+
+  real_t buffer_save_ext(real_t index, const string_t& path, real_t offset, real_t size) {
+    std::size_t count;
+    const unsigned char* data = intern::buffer_range(index, offset, size, count);
+    return intern::write_file(path, data, count) ? 0 : -1;
+  }
+
+  real_t buffer_load(const string_t& path) {
+#ifdef ART_BUFFER_MMAP
+    real_t mapped = intern::buffer_map(path);
+    if (mapped >= 0) {
+      return mapped;
+    }
+#endif
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!file) {
+      return -1;
+    }
+    std::size_t size;
+    if (!intern::file_size(file, size)) {
+      return -1;
+    }
+    real_t index = buffer_create(size, intern::bm_grow, 1);
+    if (!intern::read_bytes(file, intern::buffer_from_index(index).data, size)) {
+      buffer_delete(index);
+      return -1;
+    }
+    return index;
+  }
+
+  real_t buffer_load_ext(real_t index, const string_t& path, real_t offset) {
+    intern::buffer& buf = intern::buffer_from_index(index);
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!file) {
+      return -1;
+    }
+    std::size_t size;
+    if (!intern::file_size(file, size)) {
+      return -1;
+    }
+    std::size_t first = intern::to_size(offset);
+    if (buf.mode == intern::bm_grow && first + size > buf.size) {
+      buf.resize(first + size);
+    }
+    if (first >= buf.size) {
+      return -1;
+    }
+    return intern::read_bytes(file, buf.data + first, std::min(size, buf.size - first)) ? 0 : -1;
+  }
+
+  real_t buffer_save_async(real_t index, const string_t& path, real_t offset, real_t size) {
+    std::size_t count;
+    const unsigned char* data = intern::buffer_range(index, offset, size, count);
+    real_t id = intern::async_next_id++;
+    intern::async_request request = {id, index, 0, path, true, 0, 0, {}, false};
+    request.data.assign(data, data + count);
+    intern::io.submit(std::move(request));
+    return id;
+  }
+
+  real_t buffer_load_async(real_t index, const string_t& path, real_t offset, real_t size) {
+    unsigned long generation = intern::buffer_from_index(index).generation;
+    real_t id = intern::async_next_id++;
+    intern::io.submit(intern::async_request{id, index, generation, path, false, intern::to_size(offset), size, {}, false});
+    return id;
+  }
+
+  real_t buffer_async_id() {
+    return intern::async_current_id;
+  }
+
+  real_t buffer_async_status() {
+    return intern::async_current_status;
+  }
+
+  real_t buffer_copy(real_t src_index, real_t src_offset, real_t size, real_t dest_index, real_t dest_offset) {
+    intern::buffer& src = intern::buffer_from_index(src_index);
+    intern::buffer& dest = intern::buffer_from_index(dest_index);
+    std::size_t first = std::min(intern::to_size(src_offset), src.size);
+    std::size_t count = std::min(intern::to_size(size), src.size - first);
+    std::size_t to = intern::to_size(dest_offset);
+    if (to + count > dest.size) {
+      if (dest.mode == intern::bm_grow) {
+        dest.resize(to + count);
+      } else if (to >= dest.size) {
+        return -1;
+      } else {
+        count = dest.size - to;
+      }
+    }
+    // Source and destination may be the same buffer, and resizing it above may have moved its data
+    if (count) {
+      std::memmove(dest.data + to, src.data + first, count);
+    }
+    return 0;
+  }
+
+  real_t buffer_get_size(real_t index) {
+    return static_cast<real_t>(intern::buffer_from_index(index).size);
+  }
+
+  real_t buffer_resize(real_t index, real_t size) {
+    intern::buffer_from_index(index).resize(intern::to_size(size));
+    return 0;
+  }
+
+  real_t buffer_sizeof(real_t type) {
+    return static_cast<real_t>(intern::buffer_type_size(intern::buffer_type_from(type)));
+  }
+
+  string_t buffer_md5(real_t index, real_t offset, real_t size) {
+    static const unsigned shifts[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+    static const std::vector<std::uint32_t> sines = [] {
+      std::vector<std::uint32_t> table(64);
+      for (std::size_t i = 0; i < 64; ++i) {
+        table[i] = static_cast<std::uint32_t>(std::floor(std::abs(std::sin(static_cast<double>(i + 1))) * 4294967296.0));
+      }
+      return table;
+    }();
+
+    std::size_t count;
+    const unsigned char* data = intern::buffer_range(index, offset, size, count);
+    std::uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    intern::hash_blocks(data, count, false, [&state](const unsigned char* block) {
+      std::uint32_t m[16];
+      for (std::size_t i = 0; i < 16; ++i) {
+        m[i] = block[4 * i] | (block[4 * i + 1] << 8) | (block[4 * i + 2] << 16) | (static_cast<std::uint32_t>(block[4 * i + 3]) << 24);
+      }
+      std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+      for (std::size_t i = 0; i < 64; ++i) {
+        std::uint32_t f;
+        std::size_t g;
+        if (i < 16) {
+          f = (b & c) | (~b & d);
+          g = i;
+        } else if (i < 32) {
+          f = (d & b) | (~d & c);
+          g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+          f = b ^ c ^ d;
+          g = (3 * i + 5) % 16;
+        } else {
+          f = c ^ (b | ~d);
+          g = (7 * i) % 16;
+        }
+        f += a + sines[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += intern::rotate_left(f, shifts[i / 16][i % 4]);
+      }
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+    });
+
+    unsigned char digest[16];
+    for (std::size_t i = 0; i < 16; ++i) {
+      digest[i] = static_cast<unsigned char>(state[i / 4] >> (8 * (i % 4)));
+    }
+    return intern::hex_string(digest, sizeof(digest));
+  }
+
+  string_t buffer_sha1(real_t index, real_t offset, real_t size) {
+    std::size_t count;
+    const unsigned char* data = intern::buffer_range(index, offset, size, count);
+    std::uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    intern::hash_blocks(data, count, true, [&state](const unsigned char* block) {
+      std::uint32_t w[80];
+      for (std::size_t i = 0; i < 16; ++i) {
+        w[i] = (static_cast<std::uint32_t>(block[4 * i]) << 24) | (block[4 * i + 1] << 16) | (block[4 * i + 2] << 8) | block[4 * i + 3];
+      }
+      for (std::size_t i = 16; i < 80; ++i) {
+        w[i] = intern::rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+      }
+      std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+      for (std::size_t i = 0; i < 80; ++i) {
+        std::uint32_t f, k;
+        if (i < 20) {
+          f = (b & c) | (~b & d);
+          k = 0x5a827999;
+        } else if (i < 40) {
+          f = b ^ c ^ d;
+          k = 0x6ed9eba1;
+        } else if (i < 60) {
+          f = (b & c) | (b & d) | (c & d);
+          k = 0x8f1bbcdc;
+        } else {
+          f = b ^ c ^ d;
+          k = 0xca62c1d6;
+        }
+        std::uint32_t next = intern::rotate_left(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = intern::rotate_left(b, 30);
+        b = a;
+        a = next;
+      }
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+    });
+
+    unsigned char digest[20];
+    for (std::size_t i = 0; i < 20; ++i) {
+      digest[i] = static_cast<unsigned char>(state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    return intern::hex_string(digest, sizeof(digest));
+  }
+
+  string_t buffer_base64_encode(real_t index, real_t offset, real_t size) {
+    std::size_t count;
+    const unsigned char* data = intern::buffer_range(index, offset, size, count);
+    std::string out;
+    out.reserve((count + 2) / 3 * 4);
+    for (std::size_t n = 0; n < count; n += 3) {
+      std::uint32_t group = static_cast<std::uint32_t>(data[n]) << 16;
+      if (n + 1 < count) {
+        group |= data[n + 1] << 8;
+      }
+      if (n + 2 < count) {
+        group |= data[n + 2];
+      }
+      out += intern::base64_digits[(group >> 18) & 63];
+      out += intern::base64_digits[(group >> 12) & 63];
+      out += (n + 1 < count) ? intern::base64_digits[(group >> 6) & 63] : '=';
+      out += (n + 2 < count) ? intern::base64_digits[group & 63] : '=';
+    }
+    return string_t(out);
+  }
+
+  real_t buffer_base64_decode(const string_t& str) {
+    static const std::vector<int> values = [] {
+      std::vector<int> table(256, -1);
+      for (int n = 0; n < 64; ++n) {
+        table[static_cast<unsigned char>(intern::base64_digits[n])] = n;
+      }
+      return table;
+    }();
+
+    // Decodes up to the first padding, skipping anything that is not a base64 digit
+    std::vector<unsigned char> bytes;
+    std::uint32_t group = 0;
+    unsigned bits = 0;
+    for (char c : str) {
+      if (c == '=') {
+        break;
+      }
+      int val = values[static_cast<unsigned char>(c)];
+      if (val < 0) {
+        continue;
+      }
+      group = (group << 6) | static_cast<std::uint32_t>(val);
+      bits += 6;
+      if (bits >= 8) {
+        bits -= 8;
+        bytes.push_back(static_cast<unsigned char>(group >> bits));
+      }
+    }
+    real_t index = buffer_create(bytes.size(), intern::bm_grow, 1);
+    if (!bytes.empty()) {
+      std::memcpy(intern::buffer_from_index(index).data, bytes.data(), bytes.size());
+    }
+    return index;
+  }
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/collision.hpp"
+#include "art/parallel.hpp"
+#include "art/sprite.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace art {
+  namespace intern {
+    spatial_grid grid;
+    object* other_instance = nullptr;
+
+    namespace {
+      // Box around the rectangle spanned by xs and ys relative to the origin, once scaled and rotated like the
+      // instance's image
+      bbox object_transform(const object& obj, real_t (&xs)[2], real_t (&ys)[2]) {
+        for (real_t& x : xs) {
+          x *= obj._image_xscale;
+        }
+        for (real_t& y : ys) {
+          y *= obj._image_yscale;
+        }
+        bbox box = {std::min(xs[0], xs[1]), std::min(ys[0], ys[1]), std::max(xs[0], xs[1]), std::max(ys[0], ys[1])};
+        if (obj._image_angle != 0) {
+          real_t c = std::cos(gml_degtorad(obj._image_angle)), s = std::sin(gml_degtorad(obj._image_angle));
+          box = bbox{xs[0] * c + ys[0] * s, ys[0] * c - xs[0] * s, xs[0] * c + ys[0] * s, ys[0] * c - xs[0] * s};
+          for (real_t x : xs) {
+            for (real_t y : ys) {
+              box.left = std::min(box.left, x * c + y * s);
+              box.top = std::min(box.top, y * c - x * s);
+              box.right = std::max(box.right, x * c + y * s);
+              box.bottom = std::max(box.bottom, y * c - x * s);
+            }
+          }
+        }
+        return box;
+      }
+      
+      void cells_erase(std::vector<object*>& objects, object& obj) {
+        auto it = std::find(objects.begin(), objects.end(), &obj);
+        if (it != objects.end()) {
+          *it = objects.back();
+          objects.pop_back();
+        }
+      }
+    }
+
+    void object_bbox_update(const object& obj) {
+      bbox_cache& cache = obj._bbox;
+      const sprite_info* sprite = sprite_from_index(obj._sprite_index);
+      const sprite_info* mask = (obj._mask_index >= 0) ? sprite_from_index(obj._mask_index) : sprite;
+      cache.generation = sprites_generation;
+      cache.drawn = bbox{0, 0, 0, 0};
+      cache.sprited = sprite != nullptr;
+      if (sprite) {
+        real_t xs[2] = {-sprite->xoffset, sprite->width - sprite->xoffset};
+        real_t ys[2] = {-sprite->yoffset, sprite->height - sprite->yoffset};
+        cache.drawn = object_transform(obj, xs, ys);
+      }
+      cache.frame = static_cast<long>(std::floor(obj._image_index));
+      cache.masked = mask != nullptr;
+      cache.per_frame = mask && !mask->frames.empty();
+      if (!mask) {
+        cache.local = bbox{0, 0, 0, 0};
+        return;
+      }
+
+      // Outer edges of the mask's pixels relative to the origin, scaled and then rotated about it
+      const sprite_bounds& bounds = mask->frame(obj._image_index);
+      real_t xs[2] = {bounds.bbox_left - mask->xoffset, bounds.bbox_right + 1 - mask->xoffset};
+      real_t ys[2] = {bounds.bbox_top - mask->yoffset, bounds.bbox_bottom + 1 - mask->yoffset};
+      bbox box = object_transform(obj, xs, ys);
+
+      // Right and bottom are inclusive, like the sprite's own bounds
+      cache.local = bbox{box.left, box.top, std::max(box.right - 1, box.left), std::max(box.bottom - 1, box.top)};
+    }
+
+    void spatial_grid::remove(object& obj) {
+      grid_entry& entry = obj._grid;
+      if (!entry.linked) {
+        return;
+      }
+      if (entry.right - entry.left > max_span || entry.bottom - entry.top > max_span) {
+        cells_erase(this->oversized, obj);
+      } else {
+        for (long cy = entry.top; cy <= entry.bottom; ++cy) {
+          for (long cx = entry.left; cx <= entry.right; ++cx) {
+            auto it = this->cells.find(key(cx, cy));
+            cells_erase(it->second, obj);
+            if (it->second.empty()) {
+              this->cells.erase(it);
+            }
+          }
+        }
+      }
+      entry.linked = false;
+    }
+
+    void spatial_grid::forget(object& obj) {
+      this->remove(obj);
+      if (obj._grid.dirty) {
+        object* last = this->dirty.back();
+        this->dirty[obj._grid.dirty_slot] = last;
+        last->_grid.dirty_slot = obj._grid.dirty_slot;
+        this->dirty.pop_back();
+        obj._grid.dirty = false;
+      }
+    }
+
+    void spatial_grid::update() {
+      parallel_forbid("collision query");
+      for (object* obj : this->dirty) {
+        grid_entry& entry = obj->_grid;
+        entry.dirty = false;
+
+        bbox box;
+        if (obj->_destroyed || !object_bbox(*obj, box)) {
+          this->remove(*obj);
+          continue;
+        }
+        long left = this->cell(box.left), top = this->cell(box.top);
+        long right = this->cell(box.right), bottom = this->cell(box.bottom);
+        if (entry.linked && entry.left == left && entry.top == top && entry.right == right && entry.bottom == bottom) {
+          continue;
+        }
+
+        this->remove(*obj);
+        entry.left = left;
+        entry.top = top;
+        entry.right = right;
+        entry.bottom = bottom;
+        entry.linked = true;
+        if (right - left > max_span || bottom - top > max_span) {
+          this->oversized.push_back(obj);
+          continue;
+        }
+        for (long cy = top; cy <= bottom; ++cy) {
+          for (long cx = left; cx <= right; ++cx) {
+            this->cells[key(cx, cy)].push_back(obj);
+          }
+        }
+      }
+      this->dirty.clear();
+    }
+
+    bool object_matches(const object& obj, real_t target) {
+      if (target == all) {
+        return true;
+      }
+      if (target >= first_object_id) {
+        return obj._id == target;
+      }
+      return target >= 0 && object_is_a(obj, static_cast<object::index_t>(target));
+    }
+
+    void collision_perform() {
+      auto& list = event_schedule[ev_collision];
+      event_dispatch_begin(list);
+      for (std::size_t i = 0; i < list.events.size(); ++i) {
+        scheduled_event& entry = list.events[i];
+        bbox box;
+        if (entry.ev.status != event::st_normal || !object_bbox(*entry.owner, box)) {
+          continue;
+        }
+
+        object& self = *entry.owner;
+        grid.each(box, [&](object& other) {
+          bbox other_box;
+          if (&other == &self || entry.ev.status != event::st_normal || !object_is_a(other, entry.ev.metadata) ||
+              !object_bbox(other, other_box) || !bbox_overlaps(box, other_box)) {
+            return;
+          }
+
+          // Like GM, an instance colliding with something solid is first put back where it came from
+          if (other._solid) {
+            self.set_x(motion.xprevious[self._motion]);
+            self.set_y(motion.yprevious[self._motion]);
+            object_bbox(self, box);
+          }
+
+          object* previous = other_instance;
+          other_instance = &other;
+          ART_PROFILE_EVENT(ev_collision, entry.index);
+          entry.ev.fn(self, entry.ev.metadata);
+          other_instance = previous;
+        });
+      }
+      event_dispatch_end(list);
+    }
+  }
+
+  real_t instance_position(real_t x, real_t y, real_t target) {
+    real_t found = noone;
+    intern::bbox point = {x, y, x, y};
+    intern::grid.each(point, [&](object& obj) {
+      intern::bbox box;
+      if (found == noone && intern::object_matches(obj, target) && intern::object_bbox(obj, box) &&
+          intern::bbox_overlaps(point, box)) {
+        found = obj._id;
+      }
+    });
+    return found;
+  }
+
+  real_t object::instance_place(real_t x, real_t y, real_t target) {
+    intern::bbox placed;
+    if (!intern::object_bbox(*this, x, y, placed)) {
+      return noone;
+    }
+    real_t found = noone;
+    intern::grid.each(placed, [&](object& obj) {
+      intern::bbox box;
+      if (found == noone && &obj != this && intern::object_matches(obj, target) && intern::object_bbox(obj, box) &&
+          intern::bbox_overlaps(placed, box)) {
+        found = obj._id;
+      }
+    });
+    return found;
+  }
+}
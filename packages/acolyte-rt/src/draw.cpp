@@ -0,0 +1,48 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/draw.hpp"
+
+namespace art {
+  namespace intern {
+    draw_view view;
+    
+    namespace {
+      bool draw_on_screen(const object& obj) {
+        const bbox_cache& cache = object_bbox_local(obj);
+        if (!cache.sprited) {
+          return true;
+        }
+        real_t x = motion.x[obj._motion], y = motion.y[obj._motion];
+        bbox drawn = {x + cache.drawn.left, y + cache.drawn.top, x + cache.drawn.right, y + cache.drawn.bottom};
+        return bbox_overlaps(drawn, view.area);
+      }
+    }
+    
+    void view_cull(real_t left, real_t top, real_t right, real_t bottom) {
+      view.culling = true;
+      view.area = bbox{left, top, right, bottom};
+    }
+    
+    void view_uncull() {
+      view.culling = false;
+    }
+    
+    void draw_perform() {
+      ART_PROFILE_PHASE(ph_draw);
+      if (!view.culling) {
+        return event_perform(ev_draw);
+      }
+      auto& list = event_schedule[ev_draw];
+      event_dispatch_begin(list);
+      for (std::size_t i = 0; i < list.events.size(); ++i) {
+        const event& ev = list.events[i].ev;
+        if (ev.status == event::st_normal && draw_on_screen(*list.events[i].owner)) {
+          ART_PROFILE_EVENT(ev_draw, list.events[i].index);
+          ev.fn(*list.events[i].owner, ev.metadata);
+        }
+      }
+      event_dispatch_end(list);
+    }
+  }
+}
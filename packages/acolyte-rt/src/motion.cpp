@@ -0,0 +1,213 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/object.hpp"
+#include "art/collision.hpp"
+#include "art/nearest.hpp"
+#include "art/vector.hpp"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace art {
+  namespace intern {
+    motion_store motion;
+
+    namespace {
+      struct motion_arrays {
+        real_t* x;
+        real_t* y;
+        real_t* xprevious;
+        real_t* yprevious;
+        real_t* hspeed;
+        real_t* vspeed;
+        const real_t* friction;
+        const real_t* hgravity;
+        const real_t* vgravity;
+      };
+
+      void integrate_scalar(const motion_arrays& m, std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+          m.xprevious[i] = m.x[i];
+          m.yprevious[i] = m.y[i];
+
+          real_t speed = std::sqrt(m.hspeed[i] * m.hspeed[i] + m.vspeed[i] * m.vspeed[i]);
+          real_t scale = (speed > 0) ? std::max<real_t>(speed - m.friction[i], 0) / speed : 1;
+          m.hspeed[i] = m.hspeed[i] * scale + m.hgravity[i];
+          m.vspeed[i] = m.vspeed[i] * scale + m.vgravity[i];
+
+          m.x[i] += m.hspeed[i];
+          m.y[i] += m.vspeed[i];
+        }
+      }
+
+#if defined(__AVX__)
+      const std::size_t lanes = 4;
+
+      std::size_t integrate_vector(const motion_arrays& m, std::size_t count) {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d one = _mm256_set1_pd(1);
+        std::size_t i = 0;
+        for (; i + lanes <= count; i += lanes) {
+          __m256d x = _mm256_loadu_pd(m.x + i);
+          __m256d y = _mm256_loadu_pd(m.y + i);
+          __m256d h = _mm256_loadu_pd(m.hspeed + i);
+          __m256d v = _mm256_loadu_pd(m.vspeed + i);
+          _mm256_storeu_pd(m.xprevious + i, x);
+          _mm256_storeu_pd(m.yprevious + i, y);
+
+          __m256d speed = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(h, h), _mm256_mul_pd(v, v)));
+          __m256d slowed = _mm256_max_pd(_mm256_sub_pd(speed, _mm256_loadu_pd(m.friction + i)), zero);
+          __m256d moving = _mm256_cmp_pd(speed, zero, _CMP_GT_OQ);
+          __m256d scale = _mm256_blendv_pd(one, _mm256_div_pd(slowed, speed), moving);
+          h = _mm256_add_pd(_mm256_mul_pd(h, scale), _mm256_loadu_pd(m.hgravity + i));
+          v = _mm256_add_pd(_mm256_mul_pd(v, scale), _mm256_loadu_pd(m.vgravity + i));
+
+          _mm256_storeu_pd(m.hspeed + i, h);
+          _mm256_storeu_pd(m.vspeed + i, v);
+          _mm256_storeu_pd(m.x + i, _mm256_add_pd(x, h));
+          _mm256_storeu_pd(m.y + i, _mm256_add_pd(y, v));
+        }
+        return i;
+      }
+#elif defined(__SSE2__)
+      const std::size_t lanes = 2;
+
+      std::size_t integrate_vector(const motion_arrays& m, std::size_t count) {
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1);
+        std::size_t i = 0;
+        for (; i + lanes <= count; i += lanes) {
+          __m128d x = _mm_loadu_pd(m.x + i);
+          __m128d y = _mm_loadu_pd(m.y + i);
+          __m128d h = _mm_loadu_pd(m.hspeed + i);
+          __m128d v = _mm_loadu_pd(m.vspeed + i);
+          _mm_storeu_pd(m.xprevious + i, x);
+          _mm_storeu_pd(m.yprevious + i, y);
+
+          // SSE2 has no blend, so the scale of stationary lanes is selected with and/andnot
+          __m128d speed = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(h, h), _mm_mul_pd(v, v)));
+          __m128d slowed = _mm_max_pd(_mm_sub_pd(speed, _mm_loadu_pd(m.friction + i)), zero);
+          __m128d moving = _mm_cmpgt_pd(speed, zero);
+          __m128d scale = _mm_or_pd(_mm_and_pd(moving, _mm_div_pd(slowed, speed)), _mm_andnot_pd(moving, one));
+          h = _mm_add_pd(_mm_mul_pd(h, scale), _mm_loadu_pd(m.hgravity + i));
+          v = _mm_add_pd(_mm_mul_pd(v, scale), _mm_loadu_pd(m.vgravity + i));
+
+          _mm_storeu_pd(m.hspeed + i, h);
+          _mm_storeu_pd(m.vspeed + i, v);
+          _mm_storeu_pd(m.x + i, _mm_add_pd(x, h));
+          _mm_storeu_pd(m.y + i, _mm_add_pd(y, v));
+        }
+        return i;
+      }
+#else
+      std::size_t integrate_vector(const motion_arrays&, std::size_t) {
+        return 0;
+      }
+#endif
+    }
+
+    std::size_t motion_store::allocate(object& obj, real_t x, real_t y) {
+      this->x.push_back(x);
+      this->y.push_back(y);
+      this->xprevious.push_back(x);
+      this->yprevious.push_back(y);
+      this->hspeed.push_back(0);
+      this->vspeed.push_back(0);
+      this->speed.push_back(0);
+      this->direction.push_back(0);
+      this->friction.push_back(0);
+      this->hgravity.push_back(0);
+      this->vgravity.push_back(0);
+      this->sync.push_back(synced);
+      this->owner.push_back(&obj);
+      return this->owner.size() - 1;
+    }
+
+    void motion_store::release(std::size_t slot) {
+      std::size_t last = this->owner.size() - 1;
+      if (slot != last) {
+        this->copy(slot, last);
+        this->owner[slot] = this->owner[last];
+        this->owner[slot]->_motion = slot;
+      }
+
+      this->x.pop_back();
+      this->y.pop_back();
+      this->xprevious.pop_back();
+      this->yprevious.pop_back();
+      this->hspeed.pop_back();
+      this->vspeed.pop_back();
+      this->speed.pop_back();
+      this->direction.pop_back();
+      this->friction.pop_back();
+      this->hgravity.pop_back();
+      this->vgravity.pop_back();
+      this->sync.pop_back();
+      this->owner.pop_back();
+    }
+
+    void motion_store::copy(std::size_t to, std::size_t from) {
+      this->x[to] = this->x[from];
+      this->y[to] = this->y[from];
+      this->xprevious[to] = this->xprevious[from];
+      this->yprevious[to] = this->yprevious[from];
+      this->hspeed[to] = this->hspeed[from];
+      this->vspeed[to] = this->vspeed[from];
+      this->speed[to] = this->speed[from];
+      this->direction[to] = this->direction[from];
+      this->friction[to] = this->friction[from];
+      this->hgravity[to] = this->hgravity[from];
+      this->vgravity[to] = this->vgravity[from];
+      this->sync[to] = this->sync[from];
+    }
+
+    void motion_store::derive_polar(std::size_t slot) {
+      this->speed[slot] = vector_length(this->hspeed[slot], this->vspeed[slot]);
+      this->direction[slot] = vector_direction_rad(this->hspeed[slot], this->vspeed[slot]);
+      this->sync[slot] = synced;
+    }
+
+    void motion_store::derive_cartesian(std::size_t slot) {
+      this->hspeed[slot] = this->speed[slot] * std::cos(this->direction[slot]);
+      this->vspeed[slot] = -this->speed[slot] * std::sin(this->direction[slot]);
+      this->sync[slot] = synced;
+    }
+
+    void motion_store::integrate() {
+      std::size_t count = this->owner.size();
+      if (!count) {
+        return;
+      }
+
+      // The integrator works on the cartesian form, the few instances last given a speed or direction catch up first
+      for (std::size_t i = 0; i < count; ++i) {
+        this->sync_cartesian(i);
+      }
+
+      motion_arrays m = {
+        this->x.data(), this->y.data(), this->xprevious.data(), this->yprevious.data(), this->hspeed.data(),
+        this->vspeed.data(), this->friction.data(), this->hgravity.data(), this->vgravity.data()
+      };
+      integrate_scalar(m, integrate_vector(m, count), count);
+
+      // Friction and gravity change the velocity, so its polar form is left to be derived on the next read
+      for (std::size_t i = 0; i < count; ++i) {
+        if (this->friction[i] != 0 || this->hgravity[i] != 0 || this->vgravity[i] != 0) {
+          this->sync[i] = polar_stale;
+        }
+        // Destroyed instances keep their slot until they are released, but are out of the grid and trees for good
+        bool moved = (this->x[i] != this->xprevious[i] || this->y[i] != this->yprevious[i]);
+        if (moved && !this->owner[i]->_destroyed) {
+          grid.touch(*this->owner[i]);
+          nearest_touch(*this->owner[i]);
+        }
+      }
+    }
+  }
+}
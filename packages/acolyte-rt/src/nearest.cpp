@@ -0,0 +1,247 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/nearest.hpp"
+#include "art/parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace art {
+  namespace intern {
+    std::vector<nearest_index> nearest_indices;
+
+    namespace {
+      // Queries handed to the pool as one task
+      const std::size_t batch_per_task = 256;
+
+      unsigned long nearest_generation = 0;
+
+      struct candidate {
+        real_t distance;
+        object* obj;
+      };
+
+      struct closer {
+        static const bool near_side_first = true;
+
+        static bool better(real_t a, real_t b) {
+          return a < b;
+        }
+
+        // Squared distance to the closest point of the box
+        static real_t bound(const bbox& box, real_t x, real_t y) {
+          real_t dx = std::max<real_t>(std::max(box.left - x, x - box.right), 0);
+          real_t dy = std::max<real_t>(std::max(box.top - y, y - box.bottom), 0);
+          return dx * dx + dy * dy;
+        }
+      };
+
+      struct further {
+        static const bool near_side_first = false;
+
+        static bool better(real_t a, real_t b) {
+          return a > b;
+        }
+
+        // Squared distance to the furthest corner of the box
+        static real_t bound(const bbox& box, real_t x, real_t y) {
+          real_t dx = std::max(std::abs(x - box.left), std::abs(x - box.right));
+          real_t dy = std::max(std::abs(y - box.top), std::abs(y - box.bottom));
+          return dx * dx + dy * dy;
+        }
+      };
+
+      void build_range(std::vector<nearest_index::point>& points, std::size_t first, std::size_t last, bool axis_y) {
+        if (last - first < 2) {
+          return;
+        }
+        std::size_t mid = first + (last - first) / 2;
+        std::nth_element(points.begin() + first, points.begin() + mid, points.begin() + last,
+          [axis_y](const nearest_index::point& a, const nearest_index::point& b) {
+            return axis_y ? a.y < b.y : a.x < b.x;
+          });
+        build_range(points, first, mid, !axis_y);
+        build_range(points, mid + 1, last, !axis_y);
+      }
+
+      // Keeps the k best candidates seen so far, sorted best first, and walks trees pruning every subtree whose
+      // bounds cannot beat the worst of them. Only reads shared state, so searches may run concurrently.
+      template <typename Order>
+      struct search {
+        real_t x;
+        real_t y;
+        std::size_t k;
+        std::vector<candidate>& best;
+
+        bool ranks(real_t distance, const object* obj) const {
+          if (this->best.size() < this->k) {
+            return true;
+          }
+          const candidate& worst = this->best.back();
+          return Order::better(distance, worst.distance) || (distance == worst.distance && obj->_id < worst.obj->_id);
+        }
+
+        void offer(real_t px, real_t py, object* obj) {
+          real_t distance = (px - this->x) * (px - this->x) + (py - this->y) * (py - this->y);
+          if (!this->ranks(distance, obj)) {
+            return;
+          }
+          if (this->best.size() == this->k) {
+            this->best.pop_back();
+          }
+          auto it = this->best.begin();
+          while (it != this->best.end() && !Order::better(distance, it->distance) &&
+                 !(distance == it->distance && obj->_id < it->obj->_id)) {
+            ++it;
+          }
+          this->best.insert(it, candidate{distance, obj});
+        }
+
+        void descend(const nearest_index& tree, std::size_t first, std::size_t last, bool axis_y, const bbox& box) {
+          if (first >= last) {
+            return;
+          }
+          // Ties are broken by id, so only subtrees that are strictly worse can be skipped
+          if (this->best.size() == this->k && Order::better(this->best.back().distance, Order::bound(box, this->x, this->y))) {
+            return;
+          }
+
+          std::size_t mid = first + (last - first) / 2;
+          const nearest_index::point& p = tree.points[mid];
+          if (!p.obj->_destroyed && p.obj->_nearest != tree.generation) {
+            this->offer(p.x, p.y, p.obj);
+          }
+
+          real_t split = axis_y ? p.y : p.x;
+          bbox low = box, high = box;
+          (axis_y ? low.bottom : low.right) = split;
+          (axis_y ? high.top : high.left) = split;
+          if (((axis_y ? this->y : this->x) < split) == Order::near_side_first) {
+            this->descend(tree, first, mid, !axis_y, low);
+            this->descend(tree, mid + 1, last, !axis_y, high);
+          } else {
+            this->descend(tree, mid + 1, last, !axis_y, high);
+            this->descend(tree, first, mid, !axis_y, low);
+          }
+        }
+
+        void run(const nearest_index& tree) {
+          this->descend(tree, 0, tree.points.size(), false, tree.bounds);
+          for (object* obj : tree.moved) {
+            if (!obj->_destroyed) {
+              this->offer(motion.x[obj->_motion], motion.y[obj->_motion], obj);
+            }
+          }
+        }
+      };
+
+      nearest_index& nearest_prepare(object::index_t index) {
+        if (nearest_indices.size() < object_types.size()) {
+          nearest_indices.resize(object_types.size());
+        }
+        nearest_index& tree = nearest_indices[index];
+        if (!tree.generation) {
+          tree.build(index);
+        }
+        return tree;
+      }
+
+      // The object indices a query for index covers, with their trees brought up to date
+      const std::vector<object::index_t>& nearest_types(real_t index, std::vector<object::index_t>& scratch) {
+        parallel_forbid("nearest instance query");
+        const std::vector<object::index_t>* types = &scratch;
+        if (index == all) {
+          for (object::index_t n = 0; n < object_types.size(); ++n) {
+            scratch.push_back(n);
+          }
+        } else if (index >= 0) {
+          types = &object_family(static_cast<object::index_t>(index));
+        }
+        for (object::index_t member : *types) {
+          nearest_prepare(member);
+        }
+        return *types;
+      }
+
+      template <typename Order>
+      void instances_search(real_t x, real_t y, real_t index, std::size_t k, std::vector<object*>& out) {
+        out.clear();
+        if (!k) {
+          return;
+        }
+        std::vector<object::index_t> scratch;
+        std::vector<candidate> best;
+        search<Order> s = {x, y, k, best};
+        for (object::index_t member : nearest_types(index, scratch)) {
+          s.run(nearest_indices[member]);
+        }
+        for (const candidate& c : best) {
+          out.push_back(c.obj);
+        }
+      }
+    }
+
+    void nearest_index::build(object::index_t index) {
+      this->points.clear();
+      this->moved.clear();
+      this->generation = ++nearest_generation;
+
+      for (object* obj = object_types[index].first; obj; obj = obj->_type_next) {
+        if (!obj->_destroyed) {
+          this->points.push_back(point{motion.x[obj->_motion], motion.y[obj->_motion], obj});
+        }
+      }
+      if (this->points.empty()) {
+        return;
+      }
+
+      this->bounds = bbox{this->points[0].x, this->points[0].y, this->points[0].x, this->points[0].y};
+      for (const point& p : this->points) {
+        this->bounds.left = std::min(this->bounds.left, p.x);
+        this->bounds.top = std::min(this->bounds.top, p.y);
+        this->bounds.right = std::max(this->bounds.right, p.x);
+        this->bounds.bottom = std::max(this->bounds.bottom, p.y);
+      }
+      build_range(this->points, 0, this->points.size(), false);
+    }
+
+    void nearest_index::invalidate() {
+      this->points.clear();
+      this->moved.clear();
+      this->generation = 0;
+    }
+
+    void instances_nearest(real_t x, real_t y, real_t index, std::size_t k, std::vector<object*>& out) {
+      instances_search<closer>(x, y, index, k, out);
+    }
+
+    void instances_furthest(real_t x, real_t y, real_t index, std::size_t k, std::vector<object*>& out) {
+      instances_search<further>(x, y, index, k, out);
+    }
+
+    void instances_nearest_batch(const std::vector<object*>& from, real_t index, std::vector<real_t>& out) {
+      out.assign(from.size(), noone);
+      std::vector<object::index_t> scratch;
+      const std::vector<object::index_t>& types = nearest_types(index, scratch);
+
+      auto resolve = [&](std::size_t first, std::size_t last) {
+        std::vector<candidate> best;
+        for (std::size_t i = first; i < last; ++i) {
+          best.clear();
+          search<closer> s = {motion.x[from[i]->_motion], motion.y[from[i]->_motion], 1, best};
+          for (object::index_t member : types) {
+            s.run(nearest_indices[member]);
+          }
+          if (!best.empty()) {
+            out[i] = best.front().obj->_id;
+          }
+        }
+      };
+
+      parallel_for((from.size() + batch_per_task - 1) / batch_per_task, [&](std::size_t n) {
+        resolve(n * batch_per_task, std::min((n + 1) * batch_per_task, from.size()));
+      });
+    }
+  }
+}
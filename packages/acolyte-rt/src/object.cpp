@@ -2,8 +2,16 @@
 // Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
 
 #include "art/object.hpp"
+#include "art/alarm.hpp"
+#include "art/buffer.hpp"
+#include "art/collision.hpp"
+#include "art/nearest.hpp"
+#include "art/parallel.hpp"
+#include "art/sprite.hpp"
 #include "art/vector.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <iostream>
 
@@ -12,92 +20,495 @@ namespace art {
     const object::id_t first_object_id = 1000001;
     
     decltype(event_schedule) event_schedule;
-    decltype(events_pending_removal) events_pending_removal;
-    decltype(object_map) object_map;
+    decltype(object_types) object_types;
+    std::atomic<object::id_t> next_object_id(first_object_id);
+    decltype(object_map) object_map = {first_object_id, {}, {}};
+    decltype(objects_destroyed) objects_destroyed;
     
-    events_by_depth_t::iterator event_link(real_t depth, event& ev) {
-      return event_schedule[ev.type].insert(std::make_pair(depth, ev));
+    namespace {
+      bool events_before(const scheduled_event& lhs, const scheduled_event& rhs) {
+        return lhs.depth < rhs.depth || (lhs.depth == rhs.depth && lhs.index < rhs.index);
+      }
+      
+      void events_fix_links(std::vector<scheduled_event>& events, std::size_t first) {
+        for (std::size_t i = first; i < events.size(); ++i) {
+          if (events[i].owner) {
+            events[i].owner->linked_events[events[i].slot] = i;
+          }
+        }
+      }
+      
+      void events_sort(events_by_depth_t& list) {
+        auto& events = list.events;
+        events.erase(std::remove_if(events.begin(), events.end(), [](const scheduled_event& entry) {
+          return entry.ev.status == event::st_removed;
+        }), events.end());
+        std::stable_sort(events.begin(), events.end(), events_before);
+        events_fix_links(events, 0);
+        list.removed = 0;
+        list.sorted = true;
+      }
+      
+      std::size_t events_compact(events_by_depth_t& list) {
+        auto& events = list.events;
+        std::size_t live = 0;
+        for (std::size_t i = 0; i < events.size(); ++i) {
+          if (events[i].ev.status == event::st_removed) {
+            continue;
+          }
+          if (live != i) {
+            events[live] = std::move(events[i]);
+            events[live].owner->linked_events[events[live].slot] = live;
+          }
+          ++live;
+        }
+        
+        std::size_t reclaimed = events.size() - live;
+        events.erase(events.begin() + live, events.end());
+        if (events.capacity() > 2 * events.size()) {
+          std::vector<scheduled_event>(std::make_move_iterator(events.begin()),
+                                       std::make_move_iterator(events.end())).swap(events);
+        }
+        list.removed = 0;
+        return reclaimed;
+      }
+      
+      void events_append(events_by_depth_t& list, scheduled_event entry) {
+        if (!list.events.empty() && events_before(entry, list.events.back())) {
+          list.sorted = false;
+        }
+        list.events.push_back(std::move(entry));
+      }
+      
+      // Number of event lists currently being dispatched, links are staged while it is non-zero
+      unsigned events_dispatching = 0;
+      
+      void events_merge(events_by_depth_t& list) {
+        auto& pending = list.pending;
+        if (pending.empty()) {
+          return;
+        }
+        
+        // Links undone again before the phase ended, say by a second depth change, never become tombstones
+        auto live = std::remove_if(pending.begin(), pending.end(), [](const scheduled_event& entry) {
+          return entry.ev.status == event::st_removed;
+        });
+        list.removed -= pending.end() - live;
+        pending.erase(live, pending.end());
+        if (pending.empty()) {
+          return;
+        }
+        for (auto& entry : pending) {
+          entry.ev.status = event::st_normal;
+        }
+        
+        std::stable_sort(pending.begin(), pending.end(), events_before);
+        auto& events = list.events;
+        std::size_t first = events.size();
+        events.insert(events.end(), std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+        pending.clear();
+        
+        // Only the tail from where the first pending event belongs has to move
+        if (list.sorted && first && events_before(events[first], events[first - 1])) {
+          auto split = std::upper_bound(events.begin(), events.begin() + first, events[first], events_before);
+          std::inplace_merge(split, events.begin() + first, events.end(), events_before);
+          first = split - events.begin();
+        }
+        events_fix_links(events, first);
+      }
     }
     
-    void event_unlink(events_by_depth_t::iterator& it) {
-      event_schedule[(*it).second.type].erase(it);
+    std::size_t event_link(object& obj, std::size_t slot) {
+      event& ev = object_types[obj._index].events[slot];
+      auto& list = event_schedule[ev.type];
+      scheduled_event entry = {obj._depth, obj._index, &obj, slot, ev};
+      entry.ev.status = event::st_normal;
+      if (events_dispatching) {
+        entry.ev.status = event::st_pending;
+        list.pending.push_back(std::move(entry));
+        return list.events.size() + list.pending.size() - 1;
+      }
+      events_append(list, std::move(entry));
+      return list.events.size() - 1;
     }
     
-    object& object_from_id(object::id_t id) {
-      auto it = object_map.find(id);
-      if (it == object_map.end()) {
-        std::cerr << "error: object does not exist" << std::endl;
-        std::abort();
+    void event_unlink(event_type_t type, std::size_t index) {
+      auto& list = event_schedule[type];
+      auto& entry = (index < list.events.size()) ? list.events[index] : list.pending[index - list.events.size()];
+      if (entry.ev.status == event::st_removed) {
+        return;
       }
-      return *it->second;
+      entry.ev.status = event::st_removed;
+      entry.owner = nullptr;
+      ++list.removed;
     }
     
-    void with(real_t num, with_fn_t fn) {
-      switch(static_cast<unsigned long>(num)) {
-        case all:
-          return with_objects_all(fn);
-        case noone:
-          return;
-        default:
-          return (num < first_object_id) ?
-            with_objects_index(static_cast<object::index_t>(num), fn) : with_objects_id(static_cast<object::id_t>(num), fn);
+    void event_dispatch_begin(events_by_depth_t& list) {
+      if (!list.dispatching) {
+        events_merge(list);
+        if (!list.sorted) {
+          events_sort(list);
+        }
+      }
+      ++list.dispatching;
+      ++events_dispatching;
+    }
+    
+    void event_dispatch_end(events_by_depth_t& list) {
+      --list.dispatching;
+      if (--events_dispatching) {
+        return;
+      }
+      for (auto& other : event_schedule) {
+        events_merge(other);
+      }
+    }
+    
+    void event_perform(event_type_t type) {
+      auto& list = event_schedule[type];
+      event_dispatch_begin(list);
+      for (std::size_t i = 0; i < list.events.size(); ++i) {
+        const event& ev = list.events[i].ev;
+        if (ev.status == event::st_normal) {
+          ART_PROFILE_EVENT(type, list.events[i].index);
+          ev.fn(*list.events[i].owner, ev.metadata);
+        }
+      }
+      event_dispatch_end(list);
+    }
+    
+    std::size_t event_schedule_compact() {
+      std::size_t reclaimed = 0;
+      for (auto& list : event_schedule) {
+        if (list.removed && !list.dispatching) {
+          reclaimed += events_compact(list);
+        }
+      }
+      return reclaimed;
+    }
+    
+    void step() {
+      {
+        ART_PROFILE_PHASE(ph_alarm);
+        alarms_perform();
+      }
+      {
+        ART_PROFILE_PHASE(ph_async);
+        buffer_async_perform();
+      }
+      {
+        ART_PROFILE_PHASE(ph_step);
+        if (parallel_enabled()) {
+          event_perform_parallel(ev_step);
+        } else {
+          event_perform(ev_step);
+        }
+      }
+      {
+        ART_PROFILE_PHASE(ph_motion);
+        motion.integrate();
+      }
+      {
+        ART_PROFILE_PHASE(ph_collision);
+        collision_perform();
+      }
+      {
+        ART_PROFILE_PHASE(ph_compact);
+        event_schedule_compact();
+      }
+      {
+        ART_PROFILE_PHASE(ph_release);
+        objects_release();
+      }
+    }
+    
+    namespace {
+      bool object_families_stale = true;
+      
+      object_type& object_type_at(object::index_t index) {
+        if (index >= object_types.size()) {
+          object_types.resize(index + 1);
+          object_families_stale = true;
+        }
+        return object_types[index];
+      }
+      
+      void object_families_update() {
+        for (auto& type : object_types) {
+          type.family.clear();
+          type.family_mask.assign(object_types.size(), false);
+        }
+        for (object::index_t index = 0; index < object_types.size(); ++index) {
+          // Walk up the parent chain, the depth bound keeps a malformed cyclic table from looping forever
+          object::index_t ancestor = index;
+          for (std::size_t depth = 0; ancestor < object_types.size() && depth <= object_types.size(); ++depth) {
+            object_types[ancestor].family.push_back(index);
+            object_types[ancestor].family_mask[index] = true;
+            ancestor = object_types[ancestor].parent;
+          }
+        }
+        object_families_stale = false;
+      }
+      
+      void object_type_link(object& obj) {
+        object_type& type = object_type_at(obj._index);
+        obj._type_prev = type.last;
+        obj._type_next = nullptr;
+        (type.last ? type.last->_type_next : type.first) = &obj;
+        type.last = &obj;
+        ++type.count;
       }
+      
+      void object_type_unlink(object& obj) {
+        object_type& type = object_types[obj._index];
+        (obj._type_prev ? obj._type_prev->_type_next : type.first) = obj._type_next;
+        (obj._type_next ? obj._type_next->_type_prev : type.last) = obj._type_prev;
+        if (!obj._destroyed) {
+          --type.count;
+        }
+      }
+      
+      void object_mark_destroyed(object& obj) {
+        obj._destroyed = true;
+        --object_types[obj._index].count;
+        grid.remove(obj);
+      }
+      
+      void object_release_later(object& obj) {
+        obj.unlink_events();
+        objects_destroyed.push_back(&obj);
+      }
+    }
+    
+    const std::vector<object::index_t>& object_family(object::index_t index) {
+      static const std::vector<object::index_t> empty;
+      if (index >= object_types.size()) {
+        return empty;
+      }
+      if (object_families_stale) {
+        object_families_update();
+      }
+      return object_types[index].family;
+    }
+    
+    bool object_is_a(const object& obj, object::index_t index) {
+      if (index >= object_types.size()) {
+        return false;
+      }
+      if (object_families_stale) {
+        object_families_update();
+      }
+      return object_types[index].family_mask[obj._index];
+    }
+    
+    object_type* object_type_from_index(object::index_t index) {
+      if (index >= object_types.size() || !object_types[index].construct) {
+        return nullptr;
+      }
+      return &object_types[index];
+    }
+    
+    void* object_pool::allocate() {
+      if (this->free_slots.empty()) {
+        this->slabs.emplace_back(new unsigned char[this->slot_size * slots_per_slab]);
+        unsigned char* slab = this->slabs.back().get();
+        for (std::size_t n = slots_per_slab; n-- > 0;) {
+          this->free_slots.push_back(slab + n * this->slot_size);
+        }
+      }
+      void* slot = this->free_slots.back();
+      this->free_slots.pop_back();
+      return slot;
+    }
+    
+    void object_pool::release(void* slot) {
+      this->free_slots.push_back(slot);
+    }
+    
+    void object_register(object::index_t index, std::size_t size, object_construct_t construct, object::index_t parent) {
+      const std::size_t align = 16;
+      object_type& type = object_type_at(index);
+      type.construct = construct;
+      type.pool.slot_size = (size + align - 1) / align * align;
+      if (parent != no_parent) {
+        object_type_at(parent);
+      }
+      object_types[index].parent = parent;
+      object_families_stale = true;
+    }
+    
+    void object_table::insert(object::id_t id, object* obj) {
+      object::id_t offset = id - this->base;
+      std::size_t index = offset >> page_bits;
+      if (index >= this->pages.size()) {
+        this->pages.resize(index + 1);
+      }
+      if (!this->pages[index]) {
+        this->pages[index].reset(new page());
+        // New pages are almost always the newest, batches handing out ids out of order are the exception
+        this->used.insert(std::lower_bound(this->used.begin(), this->used.end(), index), index);
+      }
+      this->pages[index]->slots[offset & (page_size - 1)] = obj;
+      ++this->pages[index]->live;
     }
     
-    void with_objects_all(with_fn_t fn) {
-      for (auto& obj : object_map) {
-        fn(*obj.second);
+    void object_table::erase(object::id_t id) {
+      object::id_t offset = id - this->base;
+      page* p = this->pages[offset >> page_bits].get();
+      p->slots[offset & (page_size - 1)] = nullptr;
+      --p->live;
+    }
+    
+    void object_table::compact() {
+      // Pages are only freed once every id they cover has been handed out, the newest page stays for future ids
+      std::size_t filled = (next_object_id - this->base) >> page_bits;
+      auto kept = std::remove_if(this->used.begin(), this->used.end(), [&](std::size_t index) {
+        if (index < filled && !this->pages[index]->live) {
+          this->pages[index].reset();
+          return true;
+        }
+        return false;
+      });
+      this->used.erase(kept, this->used.end());
+      
+      std::size_t leading = std::min(this->used.empty() ? filled : this->used.front(), filled);
+      leading = std::min(leading, this->pages.size());
+      if (leading) {
+        this->pages.erase(this->pages.begin(), this->pages.begin() + leading);
+        this->base += leading * page_size;
+        for (std::size_t& index : this->used) {
+          index -= leading;
+        }
+      }
+    }
+    
+    void object_register_events(object::index_t index, std::vector<event> events) {
+      object_type& type = object_type_at(index);
+      type.alarms.fill(nullptr);
+      auto alarm = std::stable_partition(events.begin(), events.end(), [](const event& ev) {
+        return ev.type != ev_alarm;
+      });
+      for (auto it = alarm; it != events.end(); ++it) {
+        if (it->metadata >= alarm_count) {
+          std::cerr << "error: alarm number out of range" << std::endl;
+          std::abort();
+        }
+        type.alarms[it->metadata] = it->fn;
+      }
+      events.erase(alarm, events.end());
+      type.draw_events.clear();
+      for (std::size_t n = 0; n < events.size(); ++n) {
+        if (events[n].type == ev_draw) {
+          type.draw_events.push_back(n);
+        }
+      }
+      type.events = std::move(events);
+    }
+    
+    object& object_create(object::index_t index, object::id_t id, real_t x, real_t y) {
+      object_type& type = object_types[index];
+      object* obj = type.construct(type.pool.allocate(), id, x, y);
+      object_map.insert(id, obj);
+      obj->event_create();
+      return *obj;
+    }
+    
+    object& object_from_id(object::id_t id) {
+      object* obj = object_map.find(id);
+      if (!obj) {
+        std::cerr << "error: object does not exist" << std::endl;
+        std::abort();
       }
+      return *obj;
     }
     
-    void with_objects_id(object::id_t id, with_fn_t fn) {
-      fn(object_from_id(id));
+    void with_target_error(real_t num) {
+      if (num == self) {
+        std::cerr << "error: with (self) must be given the instance itself" << std::endl;
+      } else {
+        std::cerr << "error: with target does not exist" << std::endl;
+      }
+      std::abort();
     }
     
-    void with_objects_index(object::index_t index, with_fn_t fn) {
-      for (auto& obj : object_map) {
-        if (obj.second->object_index() == index) {
-          fn(*obj.second);
+    void objects_release() {
+      for (object* obj : objects_destroyed) {
+        object_type& type = object_types[obj->_index];
+        if (type.destruct) {
+          type.destruct(obj);
+        } else {
+          obj->~object();
         }
+        type.pool.release(obj);
       }
+      objects_destroyed.clear();
+      object_map.compact();
     }
   }
   
   object::object(index_t index, id_t id, real_t xpos, real_t ypos, bool solid, bool visible, bool persistent, real_t depth,
-                 real_t sprite_index, real_t mask_index, std::vector<event>& events)
+                 real_t sprite_index, real_t mask_index)
       // Specific
-    : defined_events(events), linked_events(defined_events.size()), _index(index), _id(id), _xstart(xpos), _ystart(ypos), _x(xpos), _y(ypos), _solid(solid), _visible(visible), _persistent(persistent),
+    : _index(index), _id(id), _destroyed(false), _xstart(xpos), _ystart(ypos), _solid(solid), _visible(visible), _persistent(persistent),
       _depth(depth), _sprite_index(sprite_index), _mask_index(mask_index),
                  
       // Defaults
-      _xprevious(_x), _yprevious(_y), _image_alpha(1), _image_angle(0), _image_blend(0), _image_index(0), _image_speed(1),
-      _image_xscale(1), _image_yscale(1), _direction(0), _friction(0), _hfriction(0), _vfriction(0), _gravity(0), _hgravity(0), _vgravity(0),
-      _gravity_direction(0), _speed(0), _hspeed(0), _vspeed(0) {
+      _image_alpha(1), _image_angle(0), _image_blend(0), _image_index(0), _image_speed(1),
+      _image_xscale(1), _image_yscale(1), _gravity(0), _gravity_direction(0) {
         
-    this->object::unsafe_link_events();
+    this->_motion = intern::motion.allocate(*this, xpos, ypos);
+    this->_grid = intern::grid_entry();
+    this->_bbox = intern::bbox_cache();
+    this->_nearest = 0;
+    this->_alarm.fill(0);
+    intern::grid.touch(*this);
+    intern::nearest_touch(*this);
+    intern::object_type_link(*this);
+    this->linked_events.resize(intern::object_types[index].events.size());
+    this->unsafe_link_events();
   }
   
   object::~object() {
     this->unsafe_unlink_events();
+    intern::object_type_unlink(*this);
+    intern::grid.forget(*this);
+    intern::nearest_forget(*this);
+    intern::motion.release(this->_motion);
+  }
+  
+  void object::event_create() {
+    if (event::fn_t fn = intern::object_types[this->_index].create) {
+      ART_PROFILE_EVENT(ev_create, this->_index);
+      fn(*this, 0);
+    }
+  }
+  
+  void object::event_destroy() {
+    if (event::fn_t fn = intern::object_types[this->_index].destroy) {
+      ART_PROFILE_EVENT(ev_destroy, this->_index);
+      fn(*this, 0);
+    }
   }
   
   void object::unsafe_link_events() {
-    size_t n = 0;
-    for (auto& ev : this->defined_events) {
-      this->linked_events[n++] = intern::event_link(this->_depth, ev);
+    const auto& events = intern::object_types[this->_index].events;
+    for (std::size_t n = 0; n < this->linked_events.size(); ++n) {
+      bool hidden = !this->_visible && events[n].type == ev_draw;
+      this->linked_events[n] = hidden ? intern::event_unlinked : intern::event_link(*this, n);
     }
   }
   
   void object::link_events() {
     this->unsafe_unlink_events();
-    this->linked_events.resize(this->defined_events.size());
+    this->linked_events.resize(intern::object_types[this->_index].events.size());
     this->unsafe_link_events();
   }
   
   void object::unsafe_unlink_events() {
-    for (auto& ev : this->linked_events) {
-      intern::events_pending_removal.push_front(ev);
-      (*ev).second.status = event::st_removed;
+    for (std::size_t n = 0; n < this->linked_events.size(); ++n) {
+      if (this->linked_events[n] != intern::event_unlinked) {
+        intern::event_unlink(intern::object_types[this->_index].events[n].type, this->linked_events[n]);
+      }
     }
   }
   
@@ -106,10 +517,159 @@ namespace art {
     this->linked_events.clear();
   }
   
+  void object::update_draw_events() {
+    for (std::size_t n : intern::object_types[this->_index].draw_events) {
+      std::size_t& linked = this->linked_events[n];
+      if (this->_visible && linked == intern::event_unlinked) {
+        linked = intern::event_link(*this, n);
+      } else if (!this->_visible && linked != intern::event_unlinked) {
+        intern::event_unlink(ev_draw, linked);
+        linked = intern::event_unlinked;
+      }
+    }
+  }
+  
+  void object::instance_change(real_t index, bool perf) {
+    intern::object_type* type = intern::object_type_from_index(static_cast<object::index_t>(index));
+    if (!type) {
+      std::cerr << "error: object index does not exist" << std::endl;
+      std::abort();
+    }
+    if (this->_destroyed) {
+      return;
+    }
+    object::id_t id = this->_id;
+    if (intern::defer([id, index, perf] { intern::object_from_id(id).instance_change(index, perf); })) {
+      return;
+    }
+    if (perf) {
+      this->event_destroy();
+    }
+    
+    // The instance is rebuilt under the same id, keeping its built-in instance variables
+    object* obj = type->construct(type->pool.allocate(), this->_id, this->get_x(), this->get_y());
+    intern::motion.copy(obj->_motion, this->_motion);
+    obj->_image_alpha = this->_image_alpha;
+    obj->_image_angle = this->_image_angle;
+    obj->_image_blend = this->_image_blend;
+    obj->_image_index = this->_image_index;
+    obj->_image_speed = this->_image_speed;
+    obj->_image_xscale = this->_image_xscale;
+    obj->_image_yscale = this->_image_yscale;
+    obj->_gravity = this->_gravity;
+    obj->_gravity_direction = this->_gravity_direction;
+    obj->_alarm = this->_alarm;
+    // Through the setters, which also move the instance in the event schedule and the collision grid
+    obj->set_solid(this->_solid);
+    obj->set_visible(this->_visible);
+    obj->set_persistent(this->_persistent);
+    obj->set_depth(this->_depth);
+    obj->set_sprite_index(this->_sprite_index);
+    obj->set_mask_index(this->_mask_index);
+    
+    intern::object_mark_destroyed(*this);
+    intern::object_release_later(*this);
+    intern::object_map.erase(this->_id);
+    intern::object_map.insert(obj->_id, obj);
+    if (perf) {
+      obj->event_create();
+    }
+  }
+  
+  void object::instance_destroy() {
+    if (this->_destroyed) {
+      return;
+    }
+    object::id_t id = this->_id;
+    if (intern::defer([id] {
+          if (object* obj = intern::object_map.find(id)) {
+            obj->instance_destroy();
+          }
+        })) {
+      return;
+    }
+    intern::object_mark_destroyed(*this);
+    this->event_destroy();
+    intern::object_release_later(*this);
+    if (intern::object_map.find(this->_id) == this) {
+      intern::object_map.erase(this->_id);
+    }
+  }
+  
+  object::index_t object::get_object_index() {
+    return this->_index;
+  }
+  
   property_ro<object, object::id_t, &object::get_object_index> object::object_index() {
     return {this};
   }
   
+  object::id_t object::get_id() {
+    return this->_id;
+  }
+  
+  property_ro<object, object::id_t, &object::get_id> object::id() {
+    return {this};
+  }
+  
+  real_t object::get_xstart() {
+    return this->_xstart;
+  }
+  
+  property_ro<object, real_t, &object::get_xstart> object::xstart() {
+    return {this};
+  }
+  
+  real_t object::get_ystart() {
+    return this->_ystart;
+  }
+  
+  property_ro<object, real_t, &object::get_ystart> object::ystart() {
+    return {this};
+  }
+  
+  real_t object::get_x() {
+    return intern::motion.x[this->_motion];
+  }
+  
+  void object::set_x(real_t x) {
+    intern::motion.x[this->_motion] = x;
+    this->position_changed();
+  }
+  
+  property<object, real_t, &object::get_x, &object::set_x> object::x() {
+    return {this};
+  }
+  
+  real_t object::get_y() {
+    return intern::motion.y[this->_motion];
+  }
+  
+  void object::set_y(real_t y) {
+    intern::motion.y[this->_motion] = y;
+    this->position_changed();
+  }
+  
+  property<object, real_t, &object::get_y, &object::set_y> object::y() {
+    return {this};
+  }
+  
+  real_t object::get_xprevious() {
+    return intern::motion.xprevious[this->_motion];
+  }
+  
+  property_ro<object, real_t, &object::get_xprevious> object::xprevious() {
+    return {this};
+  }
+  
+  real_t object::get_yprevious() {
+    return intern::motion.yprevious[this->_motion];
+  }
+  
+  property_ro<object, real_t, &object::get_yprevious> object::yprevious() {
+    return {this};
+  }
+  
   bool object::get_solid() {
     return this->_solid;
   }
@@ -127,8 +687,21 @@ namespace art {
   }
   
   void object::set_visible(bool visible) {
-    // TODO: link/unlink draw event from event chain
+    if (visible == this->_visible) {
+      return;
+    }
     this->_visible = visible;
+    if (this->_destroyed) {
+      return;
+    }
+    if (intern::defer([this] {
+          if (!this->_destroyed) {
+            this->update_draw_events();
+          }
+        })) {
+      return;
+    }
+    this->update_draw_events();
   }
   
   property<object, bool, &object::get_visible, &object::set_visible> object::visible() {
@@ -152,7 +725,21 @@ namespace art {
   }
   
   void object::set_depth(real_t depth) {
+    if (depth == this->_depth) {
+      return;
+    }
     this->_depth = depth;
+    // Destroyed instances have already left the schedule
+    if (this->_destroyed) {
+      return;
+    }
+    if (intern::defer([this] {
+          if (!this->_destroyed) {
+            this->link_events();
+          }
+        })) {
+      return;
+    }
     this->unsafe_unlink_events();
     this->unsafe_link_events();
   }
@@ -167,6 +754,7 @@ namespace art {
   
   void object::set_sprite_index(real_t sprite) {
     this->_sprite_index = sprite;
+    this->bbox_changed();
   }
   
   property<object, real_t, &object::get_sprite_index, &object::set_sprite_index> object::sprite_index() {
@@ -174,8 +762,8 @@ namespace art {
   }
   
   real_t object::get_sprite_width() {
-    // TODO
-    return 0;
+    const intern::sprite_info* info = intern::sprite_from_index(this->_sprite_index);
+    return info ? info->width * this->_image_xscale : 0;
   }
   
   property_ro<object, real_t, &object::get_sprite_width> object::sprite_width() {
@@ -183,8 +771,8 @@ namespace art {
   }
   
   real_t object::get_sprite_height() {
-    // TODO
-    return 0;
+    const intern::sprite_info* info = intern::sprite_from_index(this->_sprite_index);
+    return info ? info->height * this->_image_yscale : 0;
   }
   
   property_ro<object, real_t, &object::get_sprite_height> object::sprite_height() {
@@ -192,8 +780,8 @@ namespace art {
   }
   
   real_t object::get_sprite_xoffset() {
-    // TODO
-    return 0;
+    const intern::sprite_info* info = intern::sprite_from_index(this->_sprite_index);
+    return info ? info->xoffset : 0;
   }
   
   property_ro<object, real_t, &object::get_sprite_xoffset> object::sprite_xoffset() {
@@ -201,8 +789,8 @@ namespace art {
   }
   
   real_t object::get_sprite_yoffset() {
-    // TODO
-    return 0;
+    const intern::sprite_info* info = intern::sprite_from_index(this->_sprite_index);
+    return info ? info->yoffset : 0;
   }
   
   property_ro<object, real_t, &object::get_sprite_yoffset> object::sprite_yoffset() {
@@ -226,7 +814,10 @@ namespace art {
   }
   
   void object::set_image_angle(real_t angle) {
-    this->_image_angle = angle;
+    if (angle != this->_image_angle) {
+      this->_image_angle = angle;
+      this->bbox_changed();
+    }
   }
   
   property<object, real_t, &object::get_image_angle, &object::set_image_angle> object::image_angle() {
@@ -251,6 +842,9 @@ namespace art {
   
   void object::set_image_index(real_t index) {
     this->_image_index = index;
+    if (this->_bbox.per_frame && static_cast<long>(std::floor(index)) != this->_bbox.frame) {
+      this->bbox_changed();
+    }
   }
   
   property<object, real_t, &object::get_image_index, &object::set_image_index> object::image_index() {
@@ -258,8 +852,8 @@ namespace art {
   }
   
   real_t object::get_image_number() {
-    // TODO
-    return 0;
+    const intern::sprite_info* info = intern::sprite_from_index(this->_sprite_index);
+    return info ? info->image_number : 0;
   }
   
   property_ro<object, real_t, &object::get_image_number> object::image_number() {
@@ -283,7 +877,10 @@ namespace art {
   }
   
   void object::set_image_xscale(real_t xscale) {
-    this->_image_xscale = xscale;
+    if (xscale != this->_image_xscale) {
+      this->_image_xscale = xscale;
+      this->bbox_changed();
+    }
   }
   
   property<object, real_t, &object::get_image_xscale, &object::set_image_xscale> object::image_xscale() {
@@ -295,7 +892,10 @@ namespace art {
   }
   
   void object::set_image_yscale(real_t yscale) {
-    this->_image_yscale = yscale;
+    if (yscale != this->_image_yscale) {
+      this->_image_yscale = yscale;
+      this->bbox_changed();
+    }
   }
   
   property<object, real_t, &object::get_image_yscale, &object::set_image_yscale> object::image_yscale() {
@@ -308,15 +908,54 @@ namespace art {
   
   void object::set_mask_index(real_t index) {
     this->_mask_index = index;
+    this->bbox_changed();
   }
   
   property<object, real_t, &object::get_mask_index, &object::set_mask_index> object::mask_index() {
     return {this};
   }
   
+  void object::bbox_changed() {
+    this->_bbox.generation = 0;
+    if (!intern::defer([this] { intern::grid.touch(*this); })) {
+      intern::grid.touch(*this);
+    }
+  }
+  
+  void object::position_changed() {
+    if (!intern::defer([this] { this->position_changed(); })) {
+      intern::grid.touch(*this);
+      intern::nearest_touch(*this);
+    }
+  }
+  
+  real_t object::get_alarm(real_t n) {
+    if (n < 0 || n >= intern::alarm_count) {
+      std::cerr << "error: alarm number out of range" << std::endl;
+      std::abort();
+    }
+    std::uint64_t deadline = this->_alarm[static_cast<std::size_t>(n)];
+    return deadline ? static_cast<real_t>(deadline - intern::alarms.now) : -1;
+  }
+  
+  void object::set_alarm(real_t n, real_t steps) {
+    if (n < 0 || n >= intern::alarm_count) {
+      std::cerr << "error: alarm number out of range" << std::endl;
+      std::abort();
+    }
+    // Anything under a step leaves the alarm unset
+    intern::alarm_wheel::entry e = {this->_id, static_cast<std::size_t>(n), 0};
+    if (steps >= 1) {
+      e.deadline = intern::alarms.now + static_cast<std::uint64_t>(steps);
+    }
+    this->_alarm[e.n] = e.deadline;
+    if (e.deadline && !intern::defer([e] { intern::alarms.schedule(e); })) {
+      intern::alarms.schedule(e);
+    }
+  }
+  
   real_t object::get_bbox_bottom() {
-    // TODO
-    return 0;
+    return intern::motion.y[this->_motion] + intern::object_bbox_local(*this).local.bottom;
   }
   
   property_ro<object, real_t, &object::get_bbox_bottom> object::bbox_bottom() {
@@ -324,8 +963,7 @@ namespace art {
   }
   
   real_t object::get_bbox_left() {
-    // TODO
-    return 0;
+    return intern::motion.x[this->_motion] + intern::object_bbox_local(*this).local.left;
   }
   
   property_ro<object, real_t, &object::get_bbox_left> object::bbox_left() {
@@ -333,8 +971,7 @@ namespace art {
   }
   
   real_t object::get_bbox_right() {
-    // TODO
-    return 0;
+    return intern::motion.x[this->_motion] + intern::object_bbox_local(*this).local.right;
   }
   
   property_ro<object, real_t, &object::get_bbox_right> object::bbox_right() {
@@ -342,8 +979,7 @@ namespace art {
   }
   
   real_t object::get_bbox_top() {
-    // TODO
-    return 0;
+    return intern::motion.y[this->_motion] + intern::object_bbox_local(*this).local.top;
   }
   
   property_ro<object, real_t, &object::get_bbox_top> object::bbox_top() {
@@ -351,18 +987,14 @@ namespace art {
   }
   
   real_t object::get_direction() {
-    return this->_direction;
+    intern::motion.sync_polar(this->_motion);
+    return intern::motion.direction[this->_motion];
   }
   
   void object::set_direction(real_t direction) {
-    this->_direction = direction;
-    this->update_hspeed();
-    this->update_vspeed();
-    this->update_friction();
-  }
-  
-  void object::update_direction() {
-    this->_direction = intern::vector_direction_rad(this->_hspeed, this->_vspeed);
+    intern::motion.sync_polar(this->_motion);
+    intern::motion.direction[this->_motion] = direction;
+    intern::motion.sync[this->_motion] = intern::motion_store::cartesian_stale;
   }
   
   property<object, real_t, &object::get_direction, &object::set_direction> object::direction() {
@@ -370,17 +1002,11 @@ namespace art {
   }
   
   real_t object::get_friction() {
-    return this->_friction;
+    return intern::motion.friction[this->_motion];
   }
   
   void object::set_friction(real_t friction) {
-    this->_friction = friction;
-    this->update_friction();
-  }
-  
-  void object::update_friction() {
-    this->_hfriction = this->_friction * std::cos(this->_direction);
-    this->_vfriction = -this->_friction * std::sin(this->_direction);
+    intern::motion.friction[this->_motion] = friction;
   }
   
   property<object, real_t, &object::get_friction, &object::set_friction> object::friction() {
@@ -397,8 +1023,8 @@ namespace art {
   }
   
   void object::update_gravity() {
-    this->_hgravity = this->_gravity * std::cos(this->_gravity_direction);
-    this->_vgravity = -this->_gravity * std::sin(this->_gravity_direction);
+    intern::motion.hgravity[this->_motion] = this->_gravity * std::cos(this->_gravity_direction);
+    intern::motion.vgravity[this->_motion] = -this->_gravity * std::sin(this->_gravity_direction);
   }
   
   property<object, real_t, &object::get_gravity, &object::set_gravity> object::gravity() {
@@ -419,17 +1045,14 @@ namespace art {
   }
   
   real_t object::get_hspeed() {
-    return this->_hspeed;
+    intern::motion.sync_cartesian(this->_motion);
+    return intern::motion.hspeed[this->_motion];
   }
   
   void object::set_hspeed(real_t hspeed) {
-    this->_hspeed = hspeed;
-    this->update_speed();
-    this->update_direction();
-  }
-  
-  void object::update_hspeed() {
-    this->_hspeed = this->_speed * std::cos(this->_direction);
+    intern::motion.sync_cartesian(this->_motion);
+    intern::motion.hspeed[this->_motion] = hspeed;
+    intern::motion.sync[this->_motion] = intern::motion_store::polar_stale;
   }
   
   property<object, real_t, &object::get_hspeed, &object::set_hspeed> object::hspeed() {
@@ -437,17 +1060,14 @@ namespace art {
   }
   
   real_t object::get_vspeed() {
-    return this->_vspeed;
+    intern::motion.sync_cartesian(this->_motion);
+    return intern::motion.vspeed[this->_motion];
   }
   
   void object::set_vspeed(real_t vspeed) {
-    this->_vspeed = vspeed;
-    this->update_speed();
-    this->update_direction();
-  }
-  
-  void object::update_vspeed() {
-    this->_vspeed = -this->_speed * std::sin(this->_direction);
+    intern::motion.sync_cartesian(this->_motion);
+    intern::motion.vspeed[this->_motion] = vspeed;
+    intern::motion.sync[this->_motion] = intern::motion_store::polar_stale;
   }
   
   property<object, real_t, &object::get_vspeed, &object::set_vspeed> object::vspeed() {
@@ -455,28 +1075,87 @@ namespace art {
   }
   
   real_t object::get_speed() {
-    return this->_speed;
+    intern::motion.sync_polar(this->_motion);
+    return intern::motion.speed[this->_motion];
   }
   
   void object::set_speed(real_t speed) {
-    this->_speed = speed;
-    this->update_hspeed();
-    this->update_vspeed();
-  }
-  
-  void object::update_speed() {
-    this->_speed = intern::vector_length(this->_hspeed, this->_vspeed);
+    intern::motion.sync_polar(this->_motion);
+    intern::motion.speed[this->_motion] = speed;
+    intern::motion.sync[this->_motion] = intern::motion_store::cartesian_stale;
   }
   
   property<object, real_t, &object::get_speed, &object::set_speed> object::speed() {
     return {this};
   }
   
+  real_t instance_create(real_t x, real_t y, real_t index) {
+    auto type = static_cast<object::index_t>(index);
+    if (type >= intern::object_types.size() || !intern::object_types[type].construct) {
+      std::cerr << "error: object index does not exist" << std::endl;
+      std::abort();
+    }
+    
+    // Created in order once the current batch is done, the id is handed out straight away
+    object::id_t id = intern::deferred_ids ? intern::deferred_ids->next() : intern::next_object_id++;
+    if (intern::defer([type, id, x, y] { intern::object_create(type, id, x, y); })) {
+      return id;
+    }
+    intern::object_create(type, id, x, y);
+    return id;
+  }
+  
+  real_t instance_find(real_t index, real_t n) {
+    if (n < 0) {
+      return noone;
+    }
+    auto remaining = static_cast<std::size_t>(n);
+    real_t found = noone;
+    auto find = [&](const object& obj) {
+      if (found == noone && remaining-- == 0) {
+        found = obj._id;
+      }
+    };
+    if (index == all) {
+      with_objects_all(find);
+    } else {
+      with_objects_index(static_cast<object::index_t>(index), find);
+    }
+    return found;
+  }
+  
+  real_t instance_furthest(real_t x, real_t y, real_t index) {
+    std::vector<object*> found;
+    intern::instances_furthest(x, y, index, 1, found);
+    return found.empty() ? static_cast<real_t>(noone) : found.front()->_id;
+  }
+  
+  real_t instance_nearest(real_t x, real_t y, real_t index) {
+    std::vector<object*> found;
+    intern::instances_nearest(x, y, index, 1, found);
+    return found.empty() ? static_cast<real_t>(noone) : found.front()->_id;
+  }
+  
+  real_t instance_number(real_t index) {
+    if (index == all) {
+      std::size_t count = 0;
+      for (auto& type : intern::object_types) {
+        count += type.count;
+      }
+      return count;
+    }
+    std::size_t count = 0;
+    for (object::index_t member : intern::object_family(static_cast<object::index_t>(index))) {
+      count += intern::object_types[member].count;
+    }
+    return count;
+  }
+  
   bool instance_exists(object::id_t id) {
     if (id < intern::first_object_id) {
       // TODO
       return false;
     }
-    return intern::object_map.find(id) != intern::object_map.end();
+    return intern::object_map.find(id) != nullptr;
   }
 }
@@ -0,0 +1,250 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/parallel.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace art {
+  namespace intern {
+    thread_local command_buffer* deferred_commands = nullptr;
+    thread_local batch_ids* deferred_ids = nullptr;
+
+    namespace {
+      // Smallest number of events worth handing to a thread on its own
+      const std::size_t events_per_batch = 64;
+      
+      // Batches a stretch is split into at most. The split only depends on the number of events, not on the number
+      // of threads, so the ids handed out in a stretch are the same however many threads run it.
+      const std::size_t max_batches = 64;
+
+      thread_pool pool;
+
+      bool runs_in_batch(const event& ev) {
+        return ev.status != event::st_normal || ev.self_only;
+      }
+
+      void events_run_batches(events_by_depth_t& list, std::size_t first, std::size_t last) {
+        std::size_t count = last - first;
+        std::size_t batch = std::max(events_per_batch, (count + max_batches - 1) / max_batches);
+        std::size_t batches = (count + batch - 1) / batch;
+        if (batches < 2) {
+          for (std::size_t i = first; i < last; ++i) {
+            const event& ev = list.events[i].ev;
+            if (ev.status == event::st_normal) {
+              ART_PROFILE_EVENT(ev.type, list.events[i].index);
+              ev.fn(*list.events[i].owner, ev.metadata);
+            }
+          }
+          return;
+        }
+
+        std::vector<command_buffer> buffers(batches);
+        // Blocks as big as a batch, so a batch creating up to one instance per event stays within its first block
+        std::vector<batch_ids> ids;
+        for (std::size_t n = 0; n < batches; ++n) {
+          ids.emplace_back(next_object_id, n, batches, batch);
+        }
+#ifdef ACOLYTE_PROFILE
+        std::vector<profile_data> profiles(batches);
+#endif
+        pool.run(batches, [&](std::size_t n) {
+          deferred_commands = &buffers[n];
+          deferred_ids = &ids[n];
+#ifdef ACOLYTE_PROFILE
+          profile_current = &profiles[n];
+#endif
+          for (std::size_t i = first + n * batch, end = std::min(i + batch, last); i < end; ++i) {
+            const event& ev = list.events[i].ev;
+            if (ev.status == event::st_normal) {
+              ART_PROFILE_EVENT(ev.type, list.events[i].index);
+              ev.fn(*list.events[i].owner, ev.metadata);
+            }
+          }
+          deferred_commands = nullptr;
+          deferred_ids = nullptr;
+#ifdef ACOLYTE_PROFILE
+          profile_current = &profile;
+#endif
+        });
+        for (const batch_ids& used : ids) {
+          next_object_id = std::max<object::id_t>(next_object_id, used.end);
+        }
+        for (command_buffer& buffer : buffers) {
+          buffer.apply();
+        }
+#ifdef ACOLYTE_PROFILE
+        for (const profile_data& batch : profiles) {
+          profile.merge(batch);
+        }
+#endif
+      }
+    }
+
+    thread_pool::~thread_pool() {
+      this->stop();
+    }
+
+    void thread_pool::start(std::size_t count) {
+      this->stop();
+      for (std::size_t n = 0; n < std::max<std::size_t>(count, 1); ++n) {
+        this->queues.emplace_back(new queue());
+      }
+      for (std::size_t n = 1; n < this->queues.size(); ++n) {
+        this->threads.emplace_back(&thread_pool::loop, this, n);
+      }
+    }
+
+    void thread_pool::stop() {
+      {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stopping = true;
+      }
+      this->wake.notify_all();
+      for (std::thread& thread : this->threads) {
+        thread.join();
+      }
+      this->threads.clear();
+      this->queues.clear();
+      this->stopping = false;
+    }
+
+    void thread_pool::run(std::size_t tasks, const std::function<void(std::size_t)>& fn) {
+      if (this->queues.size() < 2) {
+        for (std::size_t n = 0; n < tasks; ++n) {
+          fn(n);
+        }
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->job = &fn;
+        this->remaining = tasks;
+        ++this->round;
+      }
+      std::size_t share = (tasks + this->queues.size() - 1) / this->queues.size();
+      for (std::size_t n = 0; n < this->queues.size(); ++n) {
+        std::lock_guard<std::mutex> guard(this->queues[n]->lock);
+        for (std::size_t task = n * share; task < std::min((n + 1) * share, tasks); ++task) {
+          this->queues[n]->tasks.push_back(task);
+        }
+      }
+      this->wake.notify_all();
+
+      this->work(0);
+      std::unique_lock<std::mutex> guard(this->lock);
+      this->done.wait(guard, [this] { return !this->remaining; });
+      this->job = nullptr;
+    }
+
+    bool thread_pool::next(std::size_t self, std::size_t& task) {
+      {
+        std::lock_guard<std::mutex> guard(this->queues[self]->lock);
+        if (!this->queues[self]->tasks.empty()) {
+          task = this->queues[self]->tasks.front();
+          this->queues[self]->tasks.pop_front();
+          return true;
+        }
+      }
+      for (std::size_t n = 1; n < this->queues.size(); ++n) {
+        queue& victim = *this->queues[(self + n) % this->queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+          task = victim.tasks.back();
+          victim.tasks.pop_back();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void thread_pool::work(std::size_t self) {
+      std::size_t task;
+      while (this->next(self, task)) {
+        // The job outlives every task taken from the queues, run() only returns once they have all finished
+        (*this->job)(task);
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (!--this->remaining) {
+          this->done.notify_all();
+        }
+      }
+    }
+
+    void thread_pool::loop(std::size_t self) {
+      unsigned long seen = 0;
+      for (;;) {
+        {
+          std::unique_lock<std::mutex> guard(this->lock);
+          this->wake.wait(guard, [this, seen] { return this->stopping || this->round != seen; });
+          if (this->stopping) {
+            return;
+          }
+          seen = this->round;
+        }
+        this->work(self);
+      }
+    }
+
+    void command_buffer::apply() {
+      for (auto& command : this->commands) {
+        command();
+      }
+      this->commands.clear();
+    }
+
+    void parallel_forbid(const char* what) {
+      if (deferred_commands) {
+        std::cerr << "error: " << what << " called from a self-only event" << std::endl;
+        std::abort();
+      }
+    }
+
+    void parallel_configure(std::size_t threads) {
+      if (threads < 2) {
+        pool.stop();
+      } else {
+        pool.start(threads);
+      }
+    }
+
+    bool parallel_enabled() {
+      return pool.size() > 1;
+    }
+
+    void parallel_for(std::size_t tasks, const std::function<void(std::size_t)>& fn) {
+      if (deferred_commands) {
+        for (std::size_t n = 0; n < tasks; ++n) {
+          fn(n);
+        }
+        return;
+      }
+      pool.run(tasks, fn);
+    }
+
+    void event_perform_parallel(event_type_t type) {
+      auto& list = event_schedule[type];
+      event_dispatch_begin(list);
+      for (std::size_t i = 0; i < list.events.size();) {
+        const event& ev = list.events[i].ev;
+        if (!runs_in_batch(ev)) {
+          {
+            ART_PROFILE_EVENT(type, list.events[i].index);
+            ev.fn(*list.events[i].owner, ev.metadata);
+          }
+          ++i;
+          continue;
+        }
+
+        std::size_t first = i;
+        while (i < list.events.size() && runs_in_batch(list.events[i].ev)) {
+          ++i;
+        }
+        events_run_batches(list, first, i);
+      }
+      event_dispatch_end(list);
+    }
+  }
+}
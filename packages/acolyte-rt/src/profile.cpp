@@ -0,0 +1,211 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/profile.hpp"
+#include "art/object.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#ifdef ACOLYTE_PROFILE
+// Replaces operator new and delete for the whole program the runtime is linked into, not just the runtime. Only
+// profiling builds do this, and they should not be shipped.
+void* operator new(std::size_t size) {
+  ++art::intern::profile_allocations;
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+#endif
+
+namespace art {
+  namespace intern {
+    void profile_stat::merge(const profile_stat& other) {
+      this->calls += other.calls;
+      this->nanoseconds += other.nanoseconds;
+      this->allocations += other.allocations;
+    }
+    
+    profile_stat& profile_data::event(std::size_t type) {
+      if (type >= this->events.size()) {
+        this->events.resize(type + 1);
+      }
+      return this->events[type];
+    }
+    
+    profile_stat& profile_data::object(std::size_t index) {
+      if (index >= this->objects.size()) {
+        this->objects.resize(index + 1);
+      }
+      return this->objects[index];
+    }
+    
+    void profile_data::merge(const profile_data& other) {
+      for (std::size_t n = 0; n < other.events.size(); ++n) {
+        this->event(n).merge(other.events[n]);
+      }
+      for (std::size_t n = 0; n < other.objects.size(); ++n) {
+        this->object(n).merge(other.objects[n]);
+      }
+      for (std::size_t n = 0; n < profile_phase_count; ++n) {
+        this->phases[n].merge(other.phases[n]);
+      }
+      this->with.merge(other.with);
+      this->with_instances += other.with_instances;
+    }
+    
+#ifdef ACOLYTE_PROFILE
+    namespace {
+      // Spans beyond this are dropped rather than letting a forgotten trace eat all memory
+      const std::size_t profile_trace_limit = 1 << 20;
+      
+      const char* const event_type_names[event_type_count] = {
+        "create", "destroy", "step", "alarm", "keyboard", "mouse", "collision", "other", "draw", "keyrelease"
+      };
+      
+      real_t microseconds(std::uint64_t nanoseconds) {
+        return nanoseconds / 1000.0;
+      }
+      
+      // The stat at index, or an empty one past the end, without growing the table like profile_data does
+      const profile_stat& profile_stat_at(const std::vector<profile_stat>& stats, real_t index) {
+        static const profile_stat none = profile_stat();
+        return (index >= 0 && index < stats.size()) ? stats[static_cast<std::size_t>(index)] : none;
+      }
+    }
+    
+    profile_data profile;
+    thread_local profile_data* profile_current = &profile;
+    thread_local std::uint64_t profile_allocations = 0;
+    bool profile_tracing = false;
+    std::vector<profile_span> profile_trace;
+    
+    const char* const profile_phase_names[profile_phase_count] = {
+      "alarm", "step", "motion", "collision", "compact", "release", "draw", "async"
+    };
+    
+    std::uint64_t profile_clock() {
+      static const auto epoch = std::chrono::steady_clock::now();
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+    
+    profile_scope::~profile_scope() {
+      std::uint64_t duration = profile_clock() - this->start;
+      std::uint64_t allocated = profile_allocations - this->allocations;
+      for (profile_stat* target : {&this->stat, this->also}) {
+        if (target) {
+          ++target->calls;
+          target->nanoseconds += duration;
+          target->allocations += allocated;
+        }
+      }
+      if (this->name && profile_tracing && profile_current == &profile && profile_trace.size() < profile_trace_limit) {
+        profile_trace.push_back(profile_span{this->name, this->start, duration});
+      }
+    }
+#endif
+  }
+  
+#ifdef ACOLYTE_PROFILE
+  void profile_reset() {
+    intern::profile = intern::profile_data();
+  }
+  
+  real_t profile_event_calls(real_t type) {
+    return intern::profile_stat_at(intern::profile.events, type).calls;
+  }
+  
+  real_t profile_event_time(real_t type) {
+    return intern::microseconds(intern::profile_stat_at(intern::profile.events, type).nanoseconds);
+  }
+  
+  real_t profile_object_calls(real_t index) {
+    return intern::profile_stat_at(intern::profile.objects, index).calls;
+  }
+  
+  real_t profile_object_time(real_t index) {
+    return intern::microseconds(intern::profile_stat_at(intern::profile.objects, index).nanoseconds);
+  }
+  
+  real_t profile_with_calls() {
+    return intern::profile.with.calls;
+  }
+  
+  real_t profile_with_instances() {
+    return intern::profile.with_instances;
+  }
+  
+  real_t profile_with_time() {
+    return intern::microseconds(intern::profile.with.nanoseconds);
+  }
+  
+  real_t profile_phase_time(real_t phase) {
+    return (phase >= 0 && phase < intern::profile_phase_count) ?
+      intern::microseconds(intern::profile.phases[static_cast<std::size_t>(phase)].nanoseconds) : 0;
+  }
+  
+  real_t profile_phase_allocations(real_t phase) {
+    return (phase >= 0 && phase < intern::profile_phase_count) ? intern::profile.phases[static_cast<std::size_t>(phase)].allocations : 0;
+  }
+  
+  void profile_trace_start() {
+    intern::profile_trace.clear();
+    intern::profile_tracing = true;
+  }
+  
+  real_t profile_trace_save(const string_t& path) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+      return false;
+    }
+    
+    // Chrome's trace event format: phases as complete events, the totals so far as metadata on the process
+    out << "{\"traceEvents\":[";
+    const char* separator = "";
+    for (const intern::profile_span& span : intern::profile_trace) {
+      out << separator << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":"
+          << intern::microseconds(span.start) << ",\"dur\":" << intern::microseconds(span.duration) << "}";
+      separator = ",";
+    }
+    out << "],\"otherData\":{";
+    separator = "";
+    for (std::size_t n = 0; n < intern::profile.events.size(); ++n) {
+      const intern::profile_stat& stat = intern::profile.events[n];
+      out << separator << "\"ev_" << intern::event_type_names[n] << "\":\"" << stat.calls << " calls, "
+          << intern::microseconds(stat.nanoseconds) << " us\"";
+      separator = ",";
+    }
+    for (std::size_t n = 0; n < intern::profile.objects.size(); ++n) {
+      const intern::profile_stat& stat = intern::profile.objects[n];
+      if (stat.calls) {
+        out << separator << "\"object " << n << "\":\"" << stat.calls << " calls, "
+            << intern::microseconds(stat.nanoseconds) << " us\"";
+        separator = ",";
+      }
+    }
+    out << "}}";
+    intern::profile_tracing = false;
+    return static_cast<bool>(out);
+  }
+#else
+  void profile_reset() {}
+  real_t profile_event_calls(real_t) { return 0; }
+  real_t profile_event_time(real_t) { return 0; }
+  real_t profile_object_calls(real_t) { return 0; }
+  real_t profile_object_time(real_t) { return 0; }
+  real_t profile_with_calls() { return 0; }
+  real_t profile_with_instances() { return 0; }
+  real_t profile_with_time() { return 0; }
+  real_t profile_phase_time(real_t) { return 0; }
+  real_t profile_phase_allocations(real_t) { return 0; }
+  void profile_trace_start() {}
+  real_t profile_trace_save(const string_t&) { return false; }
+#endif
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "art/sprite.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace art {
+  namespace intern {
+    decltype(sprites) sprites;
+    decltype(sprites_defined) sprites_defined;
+    unsigned long sprites_generation = 1;
+
+    const sprite_bounds& sprite_info::frame(real_t image_index) const {
+      if (this->frames.empty()) {
+        return this->bounds;
+      }
+      auto count = static_cast<long>(this->frames.size());
+      long n = static_cast<long>(std::floor(image_index)) % count;
+      return this->frames[static_cast<std::size_t>((n < 0) ? n + count : n)];
+    }
+
+    void sprite_register(real_t index, const sprite_info& info) {
+      auto n = static_cast<std::size_t>(index);
+      if (n >= sprites.size()) {
+        sprites.resize(n + 1);
+        sprites_defined.resize(n + 1);
+      }
+      sprites[n] = info;
+      sprites[n].image_number = std::max<real_t>(info.image_number, std::max<std::size_t>(info.frames.size(), 1));
+      sprites_defined[n] = true;
+      ++sprites_generation;
+    }
+
+    const sprite_info* sprite_from_index(real_t index) {
+      if (index < 0 || index >= sprites.size() || !sprites_defined[static_cast<std::size_t>(index)]) {
+        return nullptr;
+      }
+      return &sprites[static_cast<std::size_t>(index)];
+    }
+  }
+
+  real_t sprite_exists(real_t index) {
+    return intern::sprite_from_index(index) != nullptr;
+  }
+
+  real_t sprite_get_width(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->width : 0;
+  }
+
+  real_t sprite_get_height(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->height : 0;
+  }
+
+  real_t sprite_get_number(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->image_number : 0;
+  }
+
+  real_t sprite_get_xoffset(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->xoffset : 0;
+  }
+
+  real_t sprite_get_yoffset(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->yoffset : 0;
+  }
+
+  real_t sprite_get_bbox_left(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->bounds.bbox_left : 0;
+  }
+
+  real_t sprite_get_bbox_top(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->bounds.bbox_top : 0;
+  }
+
+  real_t sprite_get_bbox_right(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->bounds.bbox_right : 0;
+  }
+
+  real_t sprite_get_bbox_bottom(real_t index) {
+    const intern::sprite_info* info = intern::sprite_from_index(index);
+    return info ? info->bounds.bbox_bottom : 0;
+  }
+}
@@ -3,13 +3,118 @@
 
 #include "art/string.hpp"
 
+#include <algorithm>
+#include <cstdint>
+
 namespace art {
+  namespace {
+    // FNV-1a over the bytes, never 0 so 0 can mark a hash that was not computed yet
+    std::size_t hash_bytes(const char* data, std::size_t size) {
+      std::uint64_t hash = 14695981039346656037ull;
+      for (std::size_t n = 0; n < size; ++n) {
+        hash = (hash ^ static_cast<unsigned char>(data[n])) * 1099511628211ull;
+      }
+      return static_cast<std::size_t>(hash) | 1;
+    }
+  }
+  
+  shared_string::shared_string(const char* str, std::size_t size) {
+    std::memcpy(this->reserve(size), str, size);
+  }
+  
+  shared_string::shared_string(std::size_t size, char c) {
+    std::memset(this->reserve(size), c, size);
+  }
+  
+  char* shared_string::reserve(std::size_t size) {
+    std::memset(this->bytes, 0, sizeof(this->bytes));
+    if (size <= inline_capacity) {
+      this->bytes[inline_capacity] = static_cast<unsigned char>(inline_capacity - size);
+      return reinterpret_cast<char*>(this->bytes);
+    }
+    block* ptr = allocate(size);
+    std::memcpy(this->bytes, &ptr, sizeof(ptr));
+    this->bytes[inline_capacity] = shared_tag;
+    return ptr->chars();
+  }
+  
+  shared_string::block* shared_string::allocate(std::size_t size) {
+    block* ptr = static_cast<block*>(::operator new(sizeof(block) + size + 1));
+    new (&ptr->refs) std::atomic<unsigned long>(1);
+    ptr->size = size;
+    new (&ptr->hash) std::atomic<std::size_t>(0);
+    ptr->chars()[size] = 0;
+    return ptr;
+  }
+  
+  void shared_string::release(block* ptr) {
+    if (ptr->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ::operator delete(ptr);
+    }
+  }
+  
+  int shared_string::compare(const shared_string& other) const {
+    std::size_t lsize = this->size(), rsize = other.size();
+    int order = std::memcmp(this->data(), other.data(), std::min(lsize, rsize));
+    if (order) {
+      return order;
+    }
+    return (lsize < rsize) ? -1 : (lsize > rsize);
+  }
+  
+  bool shared_string::equals(const shared_string& other) const {
+    if (!this->is_shared() || !other.is_shared()) {
+      // Inline strings are zero padded, so all 16 bytes can be compared at once
+      return !this->is_shared() && !other.is_shared() && !std::memcmp(this->bytes, other.bytes, sizeof(this->bytes));
+    }
+    block* lhs = this->block_ptr();
+    block* rhs = other.block_ptr();
+    if (lhs == rhs) {
+      return true;
+    }
+    if (lhs->size != rhs->size) {
+      return false;
+    }
+    std::size_t lhash = lhs->hash.load(std::memory_order_relaxed), rhash = rhs->hash.load(std::memory_order_relaxed);
+    if (lhash && rhash && lhash != rhash) {
+      return false;
+    }
+    return !std::memcmp(lhs->chars(), rhs->chars(), lhs->size);
+  }
+  
+  std::size_t shared_string::hash() const {
+    if (!this->is_shared()) {
+      return hash_bytes(this->data(), this->size());
+    }
+    block* ptr = this->block_ptr();
+    std::size_t hash = ptr->hash.load(std::memory_order_relaxed);
+    if (!hash) {
+      hash = hash_bytes(ptr->chars(), ptr->size);
+      ptr->hash.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+  }
+  
+  string_t operator+(const string_t& lhs, const string_t& rhs) {
+    if (rhs.empty()) {
+      return lhs;
+    }
+    if (lhs.empty()) {
+      return rhs;
+    }
+    string_t joined;
+    char* chars = joined.reserve(lhs.size() + rhs.size());
+    std::memcpy(chars, lhs.data(), lhs.size());
+    std::memcpy(chars + lhs.size(), rhs.data(), rhs.size());
+    return joined;
+  }
+  
   string_t ansi_char(real_t val) {
-    return {{static_cast<string_t::value_type>(val)}};
+    return string_t(1, static_cast<string_t::value_type>(val));
   }
 
   string_t chr(real_t val) {
-    return {{static_cast<string_t::value_type>(val)}};
+    return string_t(1, static_cast<string_t::value_type>(val));
   }
 
   real_t ord(string_t str) {
@@ -3,132 +3,262 @@
 
 #include "art/variant.hpp"
 
-#include <iostream>
 #include <algorithm>
-#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
 
 namespace art {
-  namespace {
-    void assert_init(const variant_t& var) {
-      if (var.type == variant::vt_uninit) {
-        std::cerr << "error: attempted to access uninitialized variable" << std::endl;
-        std::abort();
-      }
-    }
-    
-    void assert_real(const variant_t& var) {
-      if (var.type != variant::vt_real) {
-        std::cerr << "error: variable is not of type real" << std::endl;
-        std::abort();
-      }
+  void variant::type_error(type_t expected) const {
+    if (this->type() == vt_uninit) {
+      std::cerr << "error: attempted to access uninitialized variable" << std::endl;
+    } else if (expected == vt_real) {
+      std::cerr << "error: variable is not of type real" << std::endl;
+    } else {
+      std::cerr << "error: variable is not of type string" << std::endl;
     }
-    
-    void assert_string(const variant_t& var) {
-      if (var.type != variant::vt_string) {
-        std::cerr << "error: variable is not of type string" << std::endl;
-        std::abort();
-      }
-    }
-  }
-  
-  variant::variant(real_t val)
-    : type(vt_real), real(val) {
+    std::abort();
   }
   
-  variant::variant(string_t val)
-    : type(vt_string), string(std::move(val)) {
-  }
-
-  variant::variant(variant && rhs)
-    : type(rhs.type), real(rhs.real), string(std::move(rhs.string)) {
-  }
-  
-  variant::operator real_t() const {
-    assert_init(*this);
-    assert_real(*this);
-    return this->real;
-  }
-  
-  variant::operator string_t() const {
-    assert_init(*this);
-    assert_string(*this);
-    return this->string;
-  }
-
   variant& variant::operator=(variant && rhs) {
-    assert_init(rhs);
-    this->type = rhs.type;
-    this->real = rhs.real;
-    this->string = std::move(rhs.string);
-    return *this;
-  }
-  
-  bool variant::operator <(const variant& rhs) const {
-    assert_init(*this);
-    if (this->type == variant::vt_real) {
-      return this->real < static_cast<real_t>(rhs);
+    if (rhs.type() == vt_uninit) {
+      rhs.type_error(vt_uninit);
     }
-    return std::lexicographical_compare(this->string.begin(), this->string.end(),
-      rhs.string.begin(), rhs.string.end(), std::less<char>());
-  }
-  
-  bool variant::operator <=(const variant& rhs) const {
-    assert_init(*this);
-    if (this->type == variant::vt_real) {
-      return this->real <= static_cast<real_t>(rhs);
+    if (this != &rhs) {
+      this->clear();
+      std::memcpy(this->bytes, rhs.bytes, sizeof(this->bytes));
+      rhs.bytes[tag_byte] = uninit_tag;
     }
-    return std::lexicographical_compare(this->string.begin(), this->string.end(),
-      rhs.string.begin(), rhs.string.end(), std::less_equal<char>());
+    return *this;
   }
   
-  bool variant::operator >(const variant& rhs) const {
-    assert_init(*this);
-    if (this->type == variant::vt_real) {
-      return this->real > static_cast<real_t>(rhs);
+  int variant::compare_strings(const variant& rhs) const {
+    // Reached unless both are reals, so either both are strings or one side holds the wrong type
+    if (this->type() == vt_uninit) {
+      this->type_error(vt_string);
+    } else if (this->type() == vt_real) {
+      rhs.type_error(vt_real);
+    } else if (rhs.type() != vt_string) {
+      rhs.type_error(vt_string);
     }
-    return std::lexicographical_compare(rhs.string.begin(), rhs.string.end(),
-      this->string.begin(), this->string.end(), std::greater<char>());
+    return this->string().compare(rhs.string());
   }
   
-  bool variant::operator >=(const variant& rhs) const {
-    assert_init(*this);
-    if (this->type == variant::vt_real) {
-      return this->real >= static_cast<real_t>(rhs);
+  std::size_t variant::hash() const {
+    if (this->type() == vt_uninit) {
+      return 0;
+    }
+    if (this->type() == vt_string) {
+      return this->string().hash();
     }
-    return std::lexicographical_compare(rhs.string.begin(), rhs.string.end(),
-      this->string.begin(), this->string.end(), std::greater_equal<char>());
+    // Adding zero folds -0 into 0, which compare equal and so must hash alike
+    real_t val = this->real() + 0.0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    bits ^= bits >> 29;
+    return static_cast<std::size_t>(bits * 0xbf58476d1ce4e5b9ull);
   }
   
   namespace intern {
-    /*
+    namespace {
+      const real_t powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+      
+      // Decimals whose power of ten is an exact double, beyond this the slow path is taken
+      const unsigned fast_decimals = 22;
+      // Scaled values from here on are no longer all exact integers
+      const real_t fast_limit = 9007199254740992.0;
+      
+      // Writes the decimal digits of val backwards, ending at end, and returns where they start
+      char* write_digits(char* end, std::uint64_t val) {
+        do {
+          *--end = static_cast<char>('0' + val % 10);
+          val /= 10;
+        } while (val);
+        return end;
+      }
+      
+      // Formats with snprintf and puts back the '.' the current locale may have replaced. No double has nonzero digits
+      // past its 1074th decimal, but past max_decimals only zeros are written, whatever the value.
+      string_t real_to_string_slow(real_t num, unsigned dec) {
+        const unsigned max_decimals = 1100;
+        char buf[max_decimals + 320];
+        int len = std::snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(std::min(dec, max_decimals)), num);
+        std::size_t out = 0;
+        bool point = false;
+        for (int n = 0; n < len; ++n) {
+          char c = buf[n];
+          if ((c >= '0' && c <= '9') || c == '-') {
+            buf[out++] = c;
+          } else if (!point) {
+            buf[out++] = '.';
+            point = true;
+          }
+        }
+        if (dec > max_decimals) {
+          return string_t(buf, out) + string_t(dec - max_decimals, '0');
+        }
+        return string_t(buf, out);
+      }
+    }
+    
     string_t real_to_string(real_t num, unsigned dec) {
-      size_t len = std::swprintf(0, 0, L"%.*f", dec, num);
-      string_t s(++len, 0);
-      std::swprintf(&s[0], len, L"%.*f", dec, num);
+      if (num != num) {
+        return string_t("nan");
+      }
+      if (num == std::numeric_limits<real_t>::infinity() || num == -std::numeric_limits<real_t>::infinity()) {
+        return string_t(num < 0 ? "-inf" : "inf");
+      }
+      if (dec > fast_decimals) {
+        return real_to_string_slow(num, dec);
+      }
+      
+      // The exact product is product + error, and the error is at most half an ulp of the product. The fraction is
+      // exact below 2^53, and halves are multiples of the ulp there too, so the error only decides exact halfway
+      // cases. Rounding the exact decimal value half to even like this gives the same digits as snprintf.
+      real_t product = std::abs(num) * powers_of_ten[dec];
+      if (product >= fast_limit) {
+        return real_to_string_slow(num, dec);
+      }
+      real_t error = std::fma(std::abs(num), powers_of_ten[dec], -product);
+      real_t scaled = std::floor(product);
+      real_t fraction = product - scaled;
+      if (fraction > 0.5 || (fraction == 0.5 && (error > 0 || (error == 0 && std::fmod(scaled, 2) != 0)))) {
+        scaled += 1;
+      }
+      
+      // The scaled value is an exact integer, printed with the point put back dec digits from the end
+      char buf[48];
+      char* end = buf + sizeof(buf);
+      char* begin = write_digits(end, static_cast<std::uint64_t>(scaled));
+      while (static_cast<unsigned>(end - begin) <= dec) {
+        *--begin = '0';
+      }
+      if (dec) {
+        std::memmove(begin - 1, begin, end - begin - dec);
+        --begin;
+        *(end - dec - 1) = '.';
+      }
+      if (num < 0 && scaled) {
+        *--begin = '-';
+      }
+      return string_t(begin, end - begin);
+    }
+    
+    real_t string_to_real(const string_t& str, bool* number) {
+      const char* it = str.begin();
+      const char* end = str.end();
+      while (it != end && (*it == ' ' || *it == '\t')) {
+        ++it;
+      }
+      bool negative = (it != end && *it == '-');
+      if (it != end && (*it == '-' || *it == '+')) {
+        ++it;
+      }
+      
+      // Up to 19 significant digits are gathered into an integer, the rest only move the decimal exponent
+      std::uint64_t mantissa = 0;
+      int digits = 0, exponent = 0;
+      bool truncated = false;
+      const char* first = it;
+      for (; it != end && *it >= '0' && *it <= '9'; ++it) {
+        if (digits < 19) {
+          mantissa = mantissa * 10 + (*it - '0');
+          digits += (mantissa != 0);
+        } else {
+          ++exponent;
+          truncated |= (*it != '0');
+        }
+      }
+      bool any = (it != first);
+      if (it != end && *it == '.') {
+        any |= (it + 1 != end && it[1] >= '0' && it[1] <= '9');
+        for (++it; it != end && *it >= '0' && *it <= '9'; ++it) {
+          if (digits < 19) {
+            mantissa = mantissa * 10 + (*it - '0');
+            digits += (mantissa != 0);
+            --exponent;
+          } else {
+            truncated |= (*it != '0');
+          }
+        }
+      }
+      if (number) {
+        *number = any;
+      }
+      if (!any) {
+        return 0;
+      }
+      if (it != end && (*it == 'e' || *it == 'E')) {
+        const char* mark = it++;
+        bool exp_negative = (it != end && *it == '-');
+        if (it != end && (*it == '-' || *it == '+')) {
+          ++it;
+        }
+        if (it == end || *it < '0' || *it > '9') {
+          it = mark;
+        } else {
+          int value = 0;
+          for (; it != end && *it >= '0' && *it <= '9'; ++it) {
+            value = std::min(value * 10 + (*it - '0'), 100000);
+          }
+          exponent += exp_negative ? -value : value;
+        }
+      }
+      
+      // Both the mantissa and the power of ten are exact doubles here, so one multiply or divide rounds correctly
+      real_t result;
+      if (!truncated && mantissa < (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        result = static_cast<real_t>(mantissa);
+        result = (exponent < 0) ? result / powers_of_ten[-exponent] : result * powers_of_ten[exponent];
+      } else {
+        // Without a decimal point the text strtod reads does not depend on the locale
+        // Dropped digits are stood in for by a trailing 1, which keeps the value between the same two neighbours
+        char buf[48];
+        char* digits_end = buf + 20;
+        char* begin = write_digits(digits_end, mantissa);
+        if (truncated) {
+          *digits_end++ = '1';
+          --exponent;
+        }
+        std::snprintf(digits_end, buf + sizeof(buf) - digits_end, "e%d", exponent);
+        result = std::strtod(begin, nullptr);
+      }
+      return negative ? -result : result;
     }
-    */
   }
 
   real_t is_real(const variant_t& var) {
-    return var.type == variant::vt_real;
+    return var.type() == variant::vt_real;
   }
 
   real_t is_string(const variant_t& var) {
-    return var.type == variant::vt_string;
+    return var.type() == variant::vt_string;
   }
 
   real_t real(variant_t var) {
-    /*if (var.type == variant::vt_string) {
-      std::wstring_convert<std::codecvt_utf8<string_t::value_type>, string_t::value_type> convert;
-      return std::stod(convert.to_bytes(var.string));
+    if (var.type() == variant::vt_string) {
+      bool number;
+      real_t val = intern::string_to_real(var.string(), &number);
+      if (!number) {
+        std::cerr << "error: string does not start with a number" << std::endl;
+        std::abort();
+      }
+      return val;
     }
-    */
     return var;
   }
 
+  // Whole numbers are shown as they are, anything else with two decimals
   string_t string(variant_t var) {
-    if (var.type == variant::vt_real) {
-      //
+    if (var.type() == variant::vt_real) {
+      real_t val = var.real();
+      return intern::real_to_string(val, (val == std::floor(val)) ? 0 : 2);
     }
     return var;
   }
@@ -0,0 +1,155 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/alarm.hpp"
+
+#include <random>
+
+namespace {
+  const art::object::index_t timer_index = 40;
+  
+  struct timer : art::object {
+    timer(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(timer_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  // (step, id, alarm) of every alarm event performed
+  std::vector<std::array<std::uint64_t, 3>> fired;
+  
+  void record_alarm(art::object& self, const art::event::metadata_t n) {
+    fired.push_back({{art::intern::alarms.now, self._id, n}});
+  }
+  
+  // Alarm 1 sets itself again, alarm 2 destroys the instance
+  void rearm(art::object& self, const art::event::metadata_t n) {
+    record_alarm(self, n);
+    self.set_alarm(1, 3);
+  }
+  
+  void destroy(art::object& self, const art::event::metadata_t n) {
+    record_alarm(self, n);
+    self.instance_destroy();
+  }
+  
+  struct alarm_test : testing::Test {
+    void SetUp() {
+      art::intern::object_register<timer>(timer_index);
+      std::vector<art::event> events;
+      for (art::event::fn_t fn : {record_alarm, rearm, destroy}) {
+        art::event ev;
+        ev.fn = fn;
+        ev.metadata = events.size();
+        ev.type = art::ev_alarm;
+        ev.status = art::event::st_normal;
+        events.push_back(ev);
+      }
+      art::intern::object_register_events(timer_index, events);
+      fired.clear();
+    }
+    
+    void TearDown() {
+      art::with_objects_index(timer_index, [](const art::object& obj) {
+        art::intern::object_from_id(obj._id).instance_destroy();
+      });
+      art::intern::step();
+    }
+    
+    art::object& create() {
+      return art::intern::object_from_id(static_cast<art::object::id_t>(art::instance_create(0, 0, timer_index)));
+    }
+    
+    std::uint64_t after(std::uint64_t steps) {
+      return art::intern::alarms.now + steps;
+    }
+  };
+}
+
+TEST_F(alarm_test, alarms_count_down_and_fire_once) {
+  art::object& a = create();
+  art::object& b = create();
+  EXPECT_EQ(-1, a.get_alarm(0));
+  
+  a.set_alarm(0, 2);
+  b.set_alarm(0, 2);
+  b.set_alarm(3, 1);
+  std::uint64_t due = after(2);
+  art::intern::step();
+  EXPECT_EQ(1, a.get_alarm(0));
+  EXPECT_EQ(-1, b.get_alarm(3));
+  art::intern::step();
+  art::intern::step();
+  
+  // Alarm 3 has no event, so only counts down
+  EXPECT_EQ((std::vector<std::array<std::uint64_t, 3>>{{{due, a._id, 0}}, {{due, b._id, 0}}}), fired);
+  EXPECT_EQ(-1, a.get_alarm(0));
+}
+
+TEST_F(alarm_test, setting_again_replaces_the_deadline) {
+  art::object& a = create();
+  a.set_alarm(0, 5);
+  a.set_alarm(0, 2);
+  art::object& b = create();
+  b.set_alarm(0, 3);
+  b.set_alarm(0, 0);
+  std::uint64_t due = after(2);
+  for (int n = 0; n < 6; ++n) {
+    art::intern::step();
+  }
+  EXPECT_EQ((std::vector<std::array<std::uint64_t, 3>>{{{due, a._id, 0}}}), fired);
+}
+
+TEST_F(alarm_test, events_may_set_alarms_and_destroy_instances) {
+  art::object& a = create();
+  art::object::id_t id = a._id;
+  a.set_alarm(1, 2);
+  a.set_alarm(2, 7);
+  a.set_alarm(0, 9);
+  std::uint64_t start = art::intern::alarms.now;
+  for (int n = 0; n < 12; ++n) {
+    art::intern::step();
+  }
+  EXPECT_EQ((std::vector<std::array<std::uint64_t, 3>>{
+    {{start + 2, id, 1}}, {{start + 5, id, 1}}, {{start + 7, id, 2}}
+  }), fired);
+  EXPECT_FALSE(art::instance_exists(id));
+}
+
+TEST(alarm_wheel, entries_come_due_at_their_deadline_across_levels) {
+  std::mt19937 gen;
+  for (std::uint64_t start : {std::uint64_t(0), std::uint64_t(1) << 32}) {
+    art::intern::alarm_wheel wheel;
+    // Start just short of where every level wraps at once, so entries cascade through all of them and overflow
+    wheel.now = start - 300;
+    std::vector<art::intern::alarm_wheel::entry> expected;
+    for (std::uint64_t delta : {1, 255, 256, 257, 299, 300, 301, 65536, 70000}) {
+      expected.push_back({expected.size(), 0, wheel.now + delta});
+    }
+    for (int n = 0; n < 200; ++n) {
+      expected.push_back({expected.size(), 0, wheel.now + 1 + gen() % 100000});
+    }
+    expected.push_back({expected.size(), 0, wheel.now + (std::uint64_t(1) << 32) + 5});
+    for (const auto& e : expected) {
+      wheel.schedule(e);
+    }
+    EXPECT_EQ(1u, wheel.overflow.size());
+    
+    std::vector<art::intern::alarm_wheel::entry> due;
+    for (int step = 0; step < 100300; ++step) {
+      std::size_t before = due.size();
+      wheel.advance(due);
+      for (std::size_t n = before; n < due.size(); ++n) {
+        ASSERT_EQ(wheel.now, due[n].deadline);
+      }
+    }
+    EXPECT_EQ(expected.size() - 1, due.size());
+    
+    // The far entry left overflow once the outermost level wrapped
+    EXPECT_TRUE(wheel.overflow.empty());
+  }
+}
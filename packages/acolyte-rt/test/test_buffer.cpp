@@ -0,0 +1,275 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/buffer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <thread>
+
+TEST(buffer, reads_back_what_was_written) {
+  art::real_t buf = art::buffer_create(0, art::buffer_grow, 1);
+  art::buffer_write(buf, art::buffer_u8, 300.0);
+  art::buffer_write(buf, art::buffer_s8, -3.0);
+  art::buffer_write(buf, art::buffer_u16, 65535.0);
+  art::buffer_write(buf, art::buffer_s16, -2.9);
+  art::buffer_write(buf, art::buffer_u32, 4000000000.0);
+  art::buffer_write(buf, art::buffer_s32, -100000.0);
+  art::buffer_write(buf, art::buffer_f16, 1.5);
+  art::buffer_write(buf, art::buffer_f32, 0.25);
+  art::buffer_write(buf, art::buffer_f64, 0.1);
+  art::buffer_write(buf, art::buffer_bool, 1.0);
+  art::buffer_write(buf, art::buffer_string, art::string_t("hello"));
+  EXPECT_EQ(1 + 1 + 2 + 2 + 4 + 4 + 2 + 4 + 8 + 1 + 6, art::buffer_get_size(buf));
+  
+  art::buffer_seek(buf, art::buffer_seek_start, 0);
+  EXPECT_EQ(44, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u8)));
+  EXPECT_EQ(-3, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_s8)));
+  EXPECT_EQ(65535, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u16)));
+  EXPECT_EQ(-2, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_s16)));
+  EXPECT_EQ(4000000000.0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u32)));
+  EXPECT_EQ(-100000, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_s32)));
+  EXPECT_EQ(1.5, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_f16)));
+  EXPECT_EQ(0.25, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_f32)));
+  EXPECT_EQ(0.1, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_f64)));
+  EXPECT_EQ(1, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_bool)));
+  EXPECT_EQ("hello", static_cast<art::string_t>(art::buffer_read(buf, art::buffer_string)));
+  EXPECT_EQ(art::buffer_get_size(buf), art::buffer_tell(buf));
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u8)));
+  art::buffer_delete(buf);
+}
+
+TEST(buffer, integers_clamp_values_a_cast_cannot_take) {
+  const art::real_t inf = std::numeric_limits<art::real_t>::infinity();
+  art::real_t buf = art::buffer_create(0, art::buffer_grow, 1);
+  art::buffer_write(buf, art::buffer_u32, std::numeric_limits<art::real_t>::quiet_NaN());
+  art::buffer_write(buf, art::buffer_u32, inf);
+  art::buffer_write(buf, art::buffer_s32, -inf);
+  art::buffer_write(buf, art::buffer_s16, 1e30);
+  art::buffer_write(buf, art::buffer_u8, -1e19);
+  art::buffer_write(buf, art::buffer_u8, -2.0);
+  
+  art::buffer_seek(buf, art::buffer_seek_start, 0);
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u32)));
+  EXPECT_EQ(4294967295.0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u32)));
+  EXPECT_EQ(-2147483648.0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_s32)));
+  EXPECT_EQ(32767, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_s16)));
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u8)));
+  // Within range values still wrap
+  EXPECT_EQ(254, static_cast<art::real_t>(art::buffer_read(buf, art::buffer_u8)));
+  art::buffer_delete(buf);
+}
+
+TEST(buffer, half_floats_round_to_nearest) {
+  art::real_t buf = art::buffer_create(2, art::buffer_fixed, 1);
+  for (art::real_t val : {0.0, -2.0, 65504.0, 6.103515625e-05, 5.960464477539063e-08, 0.0999755859375}) {
+    art::buffer_poke(buf, 0, art::buffer_f16, val);
+    EXPECT_EQ(val, static_cast<art::real_t>(art::buffer_peek(buf, 0, art::buffer_f16)));
+  }
+  art::buffer_poke(buf, 0, art::buffer_f16, 0.1);
+  EXPECT_EQ(0.0999755859375, static_cast<art::real_t>(art::buffer_peek(buf, 0, art::buffer_f16)));
+  art::buffer_poke(buf, 0, art::buffer_f16, 1e6);
+  EXPECT_TRUE(std::isinf(static_cast<art::real_t>(art::buffer_peek(buf, 0, art::buffer_f16))));
+  art::buffer_delete(buf);
+}
+
+TEST(buffer, modes_handle_running_out_of_room) {
+  art::real_t fixed = art::buffer_create(4, art::buffer_fixed, 4);
+  EXPECT_EQ(0, art::buffer_write(fixed, art::buffer_u8, 1.0));
+  // The next value is aligned to four bytes, which leaves no room
+  EXPECT_EQ(-1, art::buffer_write(fixed, art::buffer_u8, 2.0));
+  EXPECT_EQ(1, art::buffer_tell(fixed));
+  
+  art::real_t wrap = art::buffer_create(6, art::buffer_wrap, 2);
+  art::buffer_write(wrap, art::buffer_u32, 1.0);
+  art::buffer_write(wrap, art::buffer_u32, 2.0);
+  EXPECT_EQ(4, art::buffer_tell(wrap));
+  EXPECT_EQ(2, static_cast<art::real_t>(art::buffer_peek(wrap, 0, art::buffer_u32)));
+  
+  art::real_t grow = art::buffer_create(1, art::buffer_grow, 8);
+  art::buffer_write(grow, art::buffer_u8, 1.0);
+  art::buffer_write(grow, art::buffer_f64, 2.0);
+  EXPECT_EQ(16, art::buffer_get_size(grow));
+  EXPECT_EQ(2, static_cast<art::real_t>(art::buffer_peek(grow, 8, art::buffer_f64)));
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(art::intern::buffer_from_index(grow).data) % 8);
+  EXPECT_EQ(-1, art::buffer_poke(grow, 16, art::buffer_u8, 1.0));
+  
+  art::real_t fast = art::buffer_create(2, art::buffer_fast, 8);
+  EXPECT_EQ(0, art::buffer_write(fast, art::buffer_u8, 5.0));
+  EXPECT_EQ(0, art::buffer_write(fast, art::buffer_u8, 6.0));
+  EXPECT_EQ(-1, art::buffer_write(fast, art::buffer_u8, 7.0));
+  art::buffer_seek(fast, art::buffer_seek_end, -1);
+  EXPECT_EQ(6, static_cast<art::real_t>(art::buffer_read(fast, art::buffer_u8)));
+  
+  // Deleted indices are reused
+  art::buffer_delete(wrap);
+  EXPECT_EQ(wrap, art::buffer_create(1, art::buffer_fixed, 1));
+  for (art::real_t buf : {fixed, wrap, grow, fast}) {
+    art::buffer_delete(buf);
+  }
+}
+
+TEST(buffer, fills_copies_and_resizes) {
+  art::real_t buf = art::buffer_create(16, art::buffer_fixed, 4);
+  art::buffer_fill(buf, 0, art::buffer_u16, 0xabcd, 10);
+  EXPECT_EQ(0xabcd, static_cast<art::real_t>(art::buffer_peek(buf, 8, art::buffer_u16)));
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_peek(buf, 2, art::buffer_u16)));
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_peek(buf, 12, art::buffer_u16)));
+  
+  art::real_t copy = art::buffer_create(0, art::buffer_grow, 1);
+  art::buffer_copy(buf, 4, 8, copy, 2);
+  EXPECT_EQ(10, art::buffer_get_size(copy));
+  EXPECT_EQ(0xabcd, static_cast<art::real_t>(art::buffer_peek(copy, 2, art::buffer_u16)));
+  
+  art::buffer_resize(buf, 2);
+  art::buffer_resize(buf, 4);
+  EXPECT_EQ(0xabcd, static_cast<art::real_t>(art::buffer_peek(buf, 0, art::buffer_u16)));
+  EXPECT_EQ(0, static_cast<art::real_t>(art::buffer_peek(buf, 2, art::buffer_u16)));
+  art::buffer_delete(buf);
+  art::buffer_delete(copy);
+}
+
+TEST(buffer, hashes_and_encodes) {
+  art::real_t buf = art::buffer_create(0, art::buffer_grow, 1);
+  EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", art::buffer_md5(buf, 0, 0));
+  EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", art::buffer_sha1(buf, 0, 0));
+  
+  std::string text = "The quick brown fox jumps over the lazy dog";
+  for (char c : text) {
+    art::buffer_write(buf, art::buffer_u8, static_cast<art::real_t>(c));
+  }
+  EXPECT_EQ("9e107d9d372bb6826bd81d3542a419d6", art::buffer_md5(buf, 0, text.size()));
+  EXPECT_EQ("2fd4e1c67a2d28fced849ee1bb76e7391b93eb12", art::buffer_sha1(buf, 0, 1000));
+  EXPECT_EQ("ZG9n", art::buffer_base64_encode(buf, 40, 3));
+  EXPECT_EQ("ZG8=", art::buffer_base64_encode(buf, 40, 2));
+  
+  art::string_t encoded = art::buffer_base64_encode(buf, 0, text.size());
+  art::real_t decoded = art::buffer_base64_decode(encoded);
+  EXPECT_EQ(text.size(), art::buffer_get_size(decoded));
+  EXPECT_EQ(art::buffer_sha1(buf, 0, text.size()), art::buffer_sha1(decoded, 0, text.size()));
+  art::buffer_delete(buf);
+  art::buffer_delete(decoded);
+}
+
+TEST(buffer, saves_and_loads) {
+  art::string_t path("acolyte_rt_test_buffer.bin");
+  art::real_t buf = art::buffer_create(0, art::buffer_grow, 1);
+  art::buffer_write(buf, art::buffer_string, art::string_t("saved"));
+  art::buffer_write(buf, art::buffer_f64, 2.5);
+  EXPECT_EQ(0, art::buffer_save(buf, path));
+  
+  art::real_t loaded = art::buffer_load(path);
+  ASSERT_NE(-1, loaded);
+  EXPECT_EQ(art::buffer_get_size(buf), art::buffer_get_size(loaded));
+  EXPECT_EQ("saved", static_cast<art::string_t>(art::buffer_read(loaded, art::buffer_string)));
+  EXPECT_EQ(2.5, static_cast<art::real_t>(art::buffer_read(loaded, art::buffer_f64)));
+  
+  art::real_t into = art::buffer_create(4, art::buffer_fixed, 1);
+  EXPECT_EQ(0, art::buffer_load_ext(into, path, 1));
+  EXPECT_EQ("sav", static_cast<art::string_t>(art::buffer_peek(into, 1, art::buffer_string)));
+  EXPECT_EQ(-1, art::buffer_load(art::string_t("no such file")));
+  
+  std::remove(path.c_str());
+  for (art::real_t n : {buf, loaded, into}) {
+    art::buffer_delete(n);
+  }
+}
+
+TEST(buffer, large_files_are_mapped_and_copied_on_write) {
+  art::string_t path("acolyte_rt_test_mapped.bin");
+  std::size_t size = art::intern::buffer_mapping_threshold * 2 + 3;
+  art::real_t buf = art::buffer_create(size, art::buffer_fixed, 1);
+  for (std::size_t n = 0; n < size; n += 4096) {
+    art::buffer_poke(buf, n, art::buffer_u8, static_cast<art::real_t>(n / 4096));
+  }
+  art::buffer_save(buf, path);
+  
+  art::real_t loaded = art::buffer_load(path);
+  EXPECT_EQ(size, art::buffer_get_size(loaded));
+  EXPECT_EQ(art::buffer_md5(buf, 0, size), art::buffer_md5(loaded, 0, size));
+  
+  // Writes change the buffer but not the file, growing moves the contents out of the mapping
+  art::buffer_poke(loaded, 4096, art::buffer_u8, 200.0);
+  art::real_t again = art::buffer_load(path);
+  EXPECT_EQ(1, static_cast<art::real_t>(art::buffer_peek(again, 4096, art::buffer_u8)));
+  art::buffer_seek(loaded, art::buffer_seek_end, 0);
+  art::buffer_write(loaded, art::buffer_u32, 77.0);
+  EXPECT_EQ(size + 4, art::buffer_get_size(loaded));
+  EXPECT_EQ(200, static_cast<art::real_t>(art::buffer_peek(loaded, 4096, art::buffer_u8)));
+  EXPECT_EQ(2, static_cast<art::real_t>(art::buffer_peek(loaded, 8192, art::buffer_u8)));
+  EXPECT_EQ(77, static_cast<art::real_t>(art::buffer_peek(loaded, size, art::buffer_u32)));
+  
+  std::remove(path.c_str());
+  for (art::real_t n : {buf, loaded, again}) {
+    art::buffer_delete(n);
+  }
+}
+
+namespace {
+  const art::object::index_t saver_index = 50;
+  
+  struct saver : art::object {
+    saver(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(saver_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  // (id, status) of every Async Save/Load event performed
+  std::vector<std::pair<art::real_t, art::real_t>> reported;
+}
+
+TEST(buffer, async_requests_report_through_an_event) {
+  art::intern::object_register<saver>(saver_index);
+  art::event ev;
+  ev.fn = [](art::object&, const art::event::metadata_t) {
+    reported.emplace_back(art::buffer_async_id(), art::buffer_async_status());
+  };
+  ev.metadata = art::ev_async_save_load;
+  ev.type = art::ev_other;
+  ev.status = art::event::st_normal;
+  art::intern::object_register_events(saver_index, {ev});
+  art::real_t obj = art::instance_create(0, 0, saver_index);
+  
+  art::string_t path("acolyte_rt_test_async.bin");
+  art::real_t from = art::buffer_create(0, art::buffer_grow, 1);
+  art::buffer_write(from, art::buffer_string, art::string_t("async"));
+  art::real_t into = art::buffer_create(2, art::buffer_grow, 1);
+  
+  art::real_t save = art::buffer_save_async(from, path, 0, 6);
+  art::real_t load = art::buffer_load_async(into, path, 2, -1);
+  art::real_t missing = art::buffer_load_async(into, art::string_t("no such file"), 0, -1);
+  // A load into a buffer deleted before it finishes must not land in the buffer that takes its index next
+  art::real_t doomed = art::buffer_create(8, art::buffer_fixed, 1);
+  art::real_t late = art::buffer_load_async(doomed, path, 0, -1);
+  art::buffer_delete(doomed);
+  art::real_t reused = art::buffer_create(8, art::buffer_fixed, 1);
+  ASSERT_EQ(doomed, reused);
+  for (int n = 0; n < 1000 && reported.size() < 4; ++n) {
+    art::intern::step();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(4u, reported.size());
+  EXPECT_EQ(std::make_pair(save, 1.0), reported[0]);
+  EXPECT_EQ(std::make_pair(load, 1.0), reported[1]);
+  EXPECT_EQ(std::make_pair(missing, 0.0), reported[2]);
+  EXPECT_EQ(std::make_pair(late, 0.0), reported[3]);
+  EXPECT_EQ("", static_cast<art::string_t>(art::buffer_peek(reused, 0, art::buffer_string)));
+  EXPECT_EQ(-1, art::buffer_async_id());
+  EXPECT_EQ(8, art::buffer_get_size(into));
+  EXPECT_EQ("async", static_cast<art::string_t>(art::buffer_peek(into, 2, art::buffer_string)));
+  
+  std::remove(path.c_str());
+  art::buffer_delete(from);
+  art::buffer_delete(into);
+  art::buffer_delete(reused);
+  art::intern::object_from_id(static_cast<art::object::id_t>(obj)).instance_destroy();
+  art::intern::step();
+}
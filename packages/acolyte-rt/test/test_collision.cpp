@@ -0,0 +1,121 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/collision.hpp"
+#include "art/sprite.hpp"
+
+namespace {
+  const art::object::index_t block_index = 10;
+  const art::real_t block_sprite = 0;
+  
+  std::vector<art::object::id_t> collided;
+  
+  void record_collision(art::object&, const art::event::metadata_t) {
+    collided.push_back(art::intern::other_instance->_id);
+  }
+  
+  struct block : art::object {
+    block(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(block_index, id, x, y, false, true, false, 0, block_sprite, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  struct collision_test : testing::Test {
+    void SetUp() {
+      art::intern::sprite_register(block_sprite, {16, 16, 0, 0, {0, 0, 15, 15}, 1, {}});
+      art::intern::object_register<block>(block_index);
+    }
+    
+    void TearDown() {
+      art::with_objects_index(block_index, [](const art::object& obj) {
+        art::intern::object_from_id(obj._id).instance_destroy();
+      });
+      art::intern::step();
+      art::intern::object_register_events(block_index, {});
+    }
+    
+    art::object& create(art::real_t x, art::real_t y) {
+      return art::intern::object_from_id(static_cast<art::object::id_t>(art::instance_create(x, y, block_index)));
+    }
+  };
+}
+
+TEST_F(collision_test, position_and_place_queries) {
+  art::object& a = create(0, 0);
+  art::object& b = create(100, 100);
+  
+  EXPECT_EQ(a._id, art::instance_position(8, 8, block_index));
+  EXPECT_EQ(b._id, art::instance_position(115, 115, art::all));
+  EXPECT_EQ(art::noone, art::instance_position(50, 50, block_index));
+  
+  EXPECT_EQ(art::noone, a.instance_place(0, 0, block_index));
+  EXPECT_EQ(b._id, a.instance_place(90, 90, block_index));
+  
+  b.set_x(8);
+  b.set_y(8);
+  EXPECT_EQ(b._id, a.instance_place(0, 0, block_index));
+  EXPECT_EQ(art::noone, art::instance_position(115, 115, block_index));
+}
+
+TEST_F(collision_test, collision_events_see_other_and_solids_push_back) {
+  art::event ev;
+  ev.fn = record_collision;
+  ev.metadata = block_index;
+  ev.type = art::ev_collision;
+  ev.status = art::event::st_normal;
+  art::intern::object_register_events(block_index, {ev});
+  
+  art::object& mover = create(0, 0);
+  art::object& wall = create(40, 0);
+  wall.set_solid(true);
+  mover.set_hspeed(30);
+  
+  collided.clear();
+  art::intern::step();
+  // The wall no longer overlaps once the mover has been put back, so only the mover sees a collision
+  EXPECT_EQ((std::vector<art::object::id_t>{wall._id}), collided);
+  EXPECT_DOUBLE_EQ(0, mover.get_x());
+}
+
+TEST_F(collision_test, bboxes_follow_transform_and_frame) {
+  art::object& a = create(100, 50);
+  EXPECT_DOUBLE_EQ(100, a.get_bbox_left());
+  EXPECT_DOUBLE_EQ(50, a.get_bbox_top());
+  EXPECT_DOUBLE_EQ(115, a.get_bbox_right());
+  EXPECT_DOUBLE_EQ(65, a.get_bbox_bottom());
+  EXPECT_DOUBLE_EQ(16, a.get_sprite_width());
+  
+  a.set_image_xscale(-2);
+  EXPECT_DOUBLE_EQ(68, a.get_bbox_left());
+  EXPECT_DOUBLE_EQ(99, a.get_bbox_right());
+  EXPECT_DOUBLE_EQ(-32, a.get_sprite_width());
+  
+  a.set_image_xscale(1);
+  a.set_image_angle(90);
+  EXPECT_NEAR(100, a.get_bbox_left(), 1e-9);
+  EXPECT_NEAR(34, a.get_bbox_top(), 1e-9);
+  EXPECT_NEAR(115, a.get_bbox_right(), 1e-9);
+  EXPECT_NEAR(49, a.get_bbox_bottom(), 1e-9);
+  
+  // A centred sprite whose second frame has a smaller mask
+  const art::real_t framed_sprite = 1;
+  art::intern::sprite_register(framed_sprite, {32, 32, 16, 16, {0, 0, 31, 31}, 2, {{0, 0, 31, 31}, {8, 8, 23, 23}}});
+  a.set_image_angle(0);
+  a.set_sprite_index(framed_sprite);
+  EXPECT_EQ(2, a.get_image_number());
+  EXPECT_DOUBLE_EQ(84, a.get_bbox_left());
+  a.set_image_index(1.5);
+  EXPECT_DOUBLE_EQ(92, a.get_bbox_left());
+  EXPECT_DOUBLE_EQ(107, a.get_bbox_right());
+  EXPECT_EQ(a._id, art::instance_position(92, 50, block_index));
+  EXPECT_EQ(art::noone, art::instance_position(88, 50, block_index));
+  
+  a.set_image_index(2);
+  EXPECT_DOUBLE_EQ(84, a.get_bbox_left());
+  EXPECT_EQ(a._id, art::instance_position(88, 50, block_index));
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/draw.hpp"
+
+namespace {
+  const art::object::index_t sprited_index = 50;
+  const art::object::index_t bare_index = 51;
+  const art::real_t draw_sprite = 50;
+  
+  std::vector<art::object::id_t> drawn;
+  
+  void record_draw(art::object& self, const art::event::metadata_t) {
+    drawn.push_back(self._id);
+  }
+  
+  template <art::object::index_t index>
+  struct drawable : art::object {
+    drawable(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(index, id, x, y, false, true, false, 0, (index == sprited_index) ? draw_sprite : -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  struct draw_test : testing::Test {
+    void SetUp() {
+      // 32x32 image around its centre, with a much smaller mask
+      art::intern::sprite_register(draw_sprite, {32, 32, 16, 16, {14, 14, 17, 17}, 1, {}});
+      art::event ev;
+      ev.fn = record_draw;
+      ev.metadata = 0;
+      ev.type = art::ev_draw;
+      ev.status = art::event::st_normal;
+      art::intern::object_register<drawable<sprited_index>>(sprited_index);
+      art::intern::object_register_events(sprited_index, {ev});
+      art::intern::object_register<drawable<bare_index>>(bare_index);
+      art::intern::object_register_events(bare_index, {ev});
+      drawn.clear();
+    }
+    
+    void TearDown() {
+      art::intern::view_uncull();
+      for (art::object::index_t index : {sprited_index, bare_index}) {
+        art::with_objects_index(index, [](const art::object& obj) {
+          art::intern::object_from_id(obj._id).instance_destroy();
+        });
+      }
+      art::intern::step();
+    }
+    
+    art::object& create(art::real_t x, art::real_t y, art::object::index_t index = sprited_index) {
+      return art::intern::object_from_id(static_cast<art::object::id_t>(art::instance_create(x, y, index)));
+    }
+  };
+}
+
+TEST_F(draw_test, invisible_instances_leave_the_draw_schedule) {
+  art::object& a = create(0, 0);
+  art::object& b = create(0, 0);
+  art::object& c = create(0, 0);
+  b.set_depth(-1);
+  art::intern::event_schedule_compact();
+  std::size_t linked = art::intern::event_schedule[art::ev_draw].events.size();
+  
+  b.set_visible(false);
+  c.set_visible(false);
+  c.set_visible(true);
+  art::intern::event_schedule_compact();
+  EXPECT_EQ(linked - 1, art::intern::event_schedule[art::ev_draw].events.size());
+  art::intern::draw_perform();
+  EXPECT_EQ((std::vector<art::object::id_t>{a._id, c._id}), drawn);
+  
+  // Changing depth while invisible keeps the instance out, becoming visible again puts it back at its depth
+  drawn.clear();
+  b.set_depth(-2);
+  art::intern::draw_perform();
+  b.set_visible(true);
+  art::intern::draw_perform();
+  EXPECT_EQ((std::vector<art::object::id_t>{a._id, c._id, b._id, a._id, c._id}), drawn);
+}
+
+TEST_F(draw_test, culling_skips_sprites_outside_the_view) {
+  art::object& inside = create(100, 100);
+  // Only the edge of the image reaches into the view, the mask does not
+  art::object& edge = create(220, 100);
+  art::object& outside = create(300, 100);
+  art::object& bare = create(1000, 1000, bare_index);
+  
+  art::intern::view_cull(0, 0, 205, 200);
+  art::intern::draw_perform();
+  EXPECT_EQ((std::vector<art::object::id_t>{inside._id, edge._id, bare._id}), drawn);
+  
+  drawn.clear();
+  outside.set_x(150);
+  inside.set_image_xscale(0.1);
+  inside.set_x(-3);
+  art::intern::draw_perform();
+  EXPECT_EQ((std::vector<art::object::id_t>{edge._id, outside._id, bare._id}), drawn);
+  
+  drawn.clear();
+  art::intern::view_uncull();
+  art::intern::draw_perform();
+  EXPECT_EQ(4u, drawn.size());
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/nearest.hpp"
+#include "art/parallel.hpp"
+
+#include <random>
+
+namespace {
+  const art::object::index_t target_index = 20;
+  const art::object::index_t child_index = 21;
+
+  template <art::object::index_t index>
+  struct target : art::object {
+    target(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+
+    void event_create() {}
+    void event_destroy() {}
+  };
+
+  // What the queries must agree with: a scan over every instance, ties going to the lowest id
+  art::real_t scan(art::real_t x, art::real_t y, art::real_t index, bool nearest) {
+    art::real_t found = art::noone;
+    art::real_t best = 0;
+    art::with_objects_index(static_cast<art::object::index_t>(index), [&](const art::object& obj) {
+      art::real_t dx = art::intern::motion.x[obj._motion] - x;
+      art::real_t dy = art::intern::motion.y[obj._motion] - y;
+      art::real_t distance = dx * dx + dy * dy;
+      if (found == art::noone || (nearest ? distance < best : distance > best) || (distance == best && obj._id < found)) {
+        best = distance;
+        found = obj._id;
+      }
+    });
+    return found;
+  }
+
+  struct nearest_test : testing::Test {
+    std::mt19937 gen;
+    std::vector<art::object::id_t> ids;
+
+    void SetUp() {
+      art::intern::object_register<target<target_index>>(target_index);
+      art::intern::object_register<target<child_index>>(child_index, target_index);
+      for (int n = 0; n < 400; ++n) {
+        ids.push_back(static_cast<art::object::id_t>(art::instance_create(coord(), coord(), (n % 3) ? target_index : child_index)));
+      }
+    }
+
+    void TearDown() {
+      art::with_objects_index(target_index, [](const art::object& obj) {
+        art::intern::object_from_id(obj._id).instance_destroy();
+      });
+      art::intern::step();
+    }
+
+    art::real_t coord() {
+      // A coarse lattice, so plenty of queries have several instances at the same distance
+      return std::uniform_int_distribution<int>(0, 40)(gen) * 8;
+    }
+
+    void expect_scan_agrees() {
+      for (int n = 0; n < 100; ++n) {
+        art::real_t x = coord() - 40, y = coord() - 40;
+        for (art::real_t index : {art::real_t(target_index), art::real_t(child_index)}) {
+          ASSERT_EQ(scan(x, y, index, true), art::instance_nearest(x, y, index));
+          ASSERT_EQ(scan(x, y, index, false), art::instance_furthest(x, y, index));
+        }
+      }
+    }
+  };
+}
+
+TEST_F(nearest_test, queries_agree_with_a_scan) {
+  expect_scan_agrees();
+  EXPECT_EQ(art::noone, art::instance_nearest(0, 0, 99));
+}
+
+TEST_F(nearest_test, queries_follow_moves_creates_and_destroys) {
+  expect_scan_agrees();
+
+  // A few changes are picked up on top of the existing tree, larger ones rebuild it
+  for (int moved : {5, 200}) {
+    for (int n = 0; n < moved; ++n) {
+      art::object& obj = art::intern::object_from_id(ids[gen() % ids.size()]);
+      obj.set_x(coord());
+      obj.set_y(coord());
+    }
+    expect_scan_agrees();
+  }
+
+  art::instance_create(-500, -500, child_index);
+  art::intern::object_from_id(ids[0]).instance_destroy();
+  expect_scan_agrees();
+
+  art::intern::object_from_id(ids[1]).set_hspeed(1000);
+  art::intern::step();
+  expect_scan_agrees();
+}
+
+TEST_F(nearest_test, k_nearest_are_ordered) {
+  std::vector<art::object*> found;
+  art::intern::instances_nearest(160, 160, art::all, 10, found);
+  ASSERT_EQ(10u, found.size());
+  art::real_t last = 0;
+  for (art::object* obj : found) {
+    art::real_t dx = obj->get_x() - 160, dy = obj->get_y() - 160;
+    EXPECT_LE(last, dx * dx + dy * dy);
+    last = dx * dx + dy * dy;
+  }
+
+  art::intern::instances_furthest(160, 160, target_index, 1000, found);
+  EXPECT_EQ(400u, found.size());
+}
+
+TEST_F(nearest_test, batch_matches_single_queries) {
+  std::vector<art::object*> from;
+  for (int n = 0; n < 4; ++n) {
+    art::with_objects_index(target_index, [&from](const art::object& obj) {
+      from.push_back(&art::intern::object_from_id(obj._id));
+    });
+  }
+
+  for (std::size_t threads : {0, 3}) {
+    art::intern::parallel_configure(threads);
+    std::vector<art::real_t> found;
+    art::intern::instances_nearest_batch(from, child_index, found);
+    art::intern::parallel_configure(0);
+    ASSERT_EQ(from.size(), found.size());
+    for (std::size_t n = 0; n < from.size(); ++n) {
+      ASSERT_EQ(art::instance_nearest(from[n]->get_x(), from[n]->get_y(), child_index), found[n]);
+    }
+  }
+}
@@ -0,0 +1,376 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/object.hpp"
+#include "art/collision.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+  std::vector<art::event::metadata_t> performed;
+  
+  void record(art::object& self, const art::event::metadata_t) {
+    performed.push_back(self._id);
+  }
+  
+  // Run once by the next event performed through record_then_hook
+  std::function<void()> hook;
+  
+  void record_then_hook(art::object& self, const art::event::metadata_t metadata) {
+    record(self, metadata);
+    if (hook) {
+      auto fn = std::move(hook);
+      hook = nullptr;
+      fn();
+    }
+  }
+  
+  // Instances of object_index 0 are built directly rather than through instance_create, and record their id
+  // whenever their step event is performed
+  struct test_object : art::object {
+    test_object(art::object::id_t id, art::real_t depth)
+      : object(0, id, 0, 0, false, true, false, depth, -1, -1) {
+    }
+  };
+  
+  struct event_schedule : testing::Test {
+    void SetUp() {
+      art::event ev;
+      ev.fn = record_then_hook;
+      ev.metadata = 0;
+      ev.type = art::ev_step;
+      ev.status = art::event::st_normal;
+      art::intern::object_register_events(0, {ev});
+    }
+  };
+  
+  const art::object::index_t pooled_index = 1;
+  
+  struct pooled_object : art::object {
+    pooled_object(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(pooled_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  const art::object::index_t parent_index = 2;
+  const art::object::index_t child_index = 3;
+  
+  template <art::object::index_t index>
+  struct family_object : art::object {
+    family_object(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+}
+
+TEST_F(event_schedule, performs_in_depth_order) {
+  test_object a(1, 10);
+  test_object b(2, -5);
+  test_object c(3, 10);
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{2, 1, 3}), performed);
+}
+
+TEST_F(event_schedule, depth_change_reorders) {
+  test_object a(1, 0);
+  test_object b(2, 1);
+  
+  a.set_depth(2);
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{2, 1}), performed);
+}
+
+TEST_F(event_schedule, unlinked_events_are_skipped) {
+  test_object a(1, 0);
+  {
+    test_object b(2, 1);
+  }
+  a.unlink_events();
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_TRUE(performed.empty());
+}
+
+TEST_F(event_schedule, events_linked_during_dispatch_run_next_time) {
+  std::unique_ptr<test_object> spawned;
+  hook = [&spawned] {
+    spawned.reset(new test_object(2, -1));
+  };
+  test_object a(1, 0);
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{1}), performed);
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{2, 1}), performed);
+}
+
+TEST_F(event_schedule, changes_during_a_phase_are_merged_in_order) {
+  std::vector<std::unique_ptr<test_object>> spawned;
+  test_object b(2, 5);
+  hook = [&] {
+    for (int depth : {7, -3, 3}) {
+      spawned.emplace_back(new test_object(10 + depth, depth));
+    }
+    b.set_depth(-10);
+    b.set_depth(6);
+  };
+  test_object a(1, 0);
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  // b was relinked by its depth change, so like the new instances it only runs from the next phase on
+  EXPECT_EQ((std::vector<art::event::metadata_t>{1}), performed);
+  EXPECT_TRUE(art::intern::event_schedule[art::ev_step].sorted);
+  EXPECT_TRUE(art::intern::event_schedule[art::ev_step].pending.empty());
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{7, 1, 13, 2, 17}), performed);
+}
+
+TEST_F(event_schedule, compaction_reclaims_tombstones) {
+  art::intern::event_schedule_compact();
+  test_object a(1, 0);
+  {
+    test_object b(2, 1);
+    test_object c(3, 2);
+  }
+  
+  EXPECT_EQ(2u, art::intern::event_schedule_compact());
+  EXPECT_EQ(0u, art::intern::event_schedule_compact());
+  EXPECT_EQ(1u, art::intern::event_schedule[art::ev_step].events.size());
+  
+  performed.clear();
+  art::intern::event_perform(art::ev_step);
+  EXPECT_EQ((std::vector<art::event::metadata_t>{1}), performed);
+}
+
+TEST(object_pool, destroyed_slots_are_reused) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  
+  auto first = static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index));
+  auto second = static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index));
+  EXPECT_TRUE(art::instance_exists(first));
+  EXPECT_LT(first, second);
+  
+  art::object* slot = &art::intern::object_from_id(first);
+  art::intern::object_from_id(first).instance_destroy();
+  EXPECT_FALSE(art::instance_exists(first));
+  EXPECT_TRUE(art::instance_exists(second));
+  
+  art::intern::step();
+  auto third = static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index));
+  EXPECT_EQ(slot, &art::intern::object_from_id(third));
+  
+  art::intern::object_from_id(second).instance_destroy();
+  art::intern::object_from_id(third).instance_destroy();
+  art::intern::step();
+}
+
+TEST(object_table, ids_resolve_after_compaction) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  
+  std::vector<art::object::id_t> ids;
+  for (std::size_t n = 0; n < 3 * art::intern::object_table::page_size; ++n) {
+    ids.push_back(static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index)));
+  }
+  for (std::size_t n = 0; n + 1 < ids.size(); ++n) {
+    art::intern::object_from_id(ids[n]).instance_destroy();
+  }
+  art::intern::step();
+  
+  EXPECT_GT(art::intern::object_map.base, ids.front());
+  EXPECT_FALSE(art::instance_exists(ids.front()));
+  EXPECT_FALSE(art::instance_exists(ids[ids.size() - 2]));
+  EXPECT_TRUE(art::instance_exists(ids.back()));
+  
+  art::intern::object_from_id(ids.back()).instance_destroy();
+  art::intern::step();
+  EXPECT_FALSE(art::instance_exists(ids.back()));
+}
+
+TEST(object_table, with_all_skips_freed_pages) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  
+  std::vector<art::object::id_t> ids;
+  for (std::size_t n = 0; n < 3 * art::intern::object_table::page_size; ++n) {
+    ids.push_back(static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index)));
+  }
+  for (std::size_t n = 1; n + 1 < ids.size(); ++n) {
+    art::intern::object_from_id(ids[n]).instance_destroy();
+  }
+  art::intern::step();
+  EXPECT_GE(2u, art::intern::object_map.used.size());
+  
+  std::vector<art::object::id_t> visited;
+  art::object::id_t created = 0;
+  art::with_objects_all([&](art::object& obj) {
+    visited.push_back(obj._id);
+    if (!created) {
+      created = static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index));
+    }
+  });
+  EXPECT_TRUE(std::is_sorted(visited.begin(), visited.end()));
+  EXPECT_NE(visited.end(), std::find(visited.begin(), visited.end(), ids.front()));
+  EXPECT_NE(visited.end(), std::find(visited.begin(), visited.end(), ids.back()));
+  EXPECT_EQ(visited.end(), std::find(visited.begin(), visited.end(), created));
+  
+  art::intern::object_from_id(ids.front()).instance_destroy();
+  art::intern::object_from_id(ids.back()).instance_destroy();
+  art::intern::object_from_id(created).instance_destroy();
+  art::intern::step();
+}
+
+TEST(object, instance_change_keeps_built_in_state) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  art::intern::object_register<family_object<parent_index>>(parent_index);
+  auto id = static_cast<art::object::id_t>(art::instance_create(4, 5, pooled_index));
+  art::object& before = art::intern::object_from_id(id);
+  before.set_visible(false);
+  before.set_solid(true);
+  before.set_persistent(true);
+  before.set_depth(-7);
+  before.set_sprite_index(3);
+  before.set_mask_index(2);
+  before.instance_change(parent_index, false);
+  
+  art::object& after = art::intern::object_from_id(id);
+  EXPECT_NE(&before, &after);
+  EXPECT_EQ(parent_index, after._index);
+  EXPECT_EQ(4, after.get_x());
+  EXPECT_FALSE(after.get_visible());
+  EXPECT_TRUE(after.get_solid());
+  EXPECT_TRUE(after.get_persistent());
+  EXPECT_EQ(-7, after.get_depth());
+  EXPECT_EQ(3, after.get_sprite_index());
+  EXPECT_EQ(2, after.get_mask_index());
+  
+  after.instance_destroy();
+  art::intern::step();
+}
+
+TEST(object, with_rejects_self) {
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_DEATH(art::with(art::self, [](art::object&) {}), "with \\(self\\) must be given the instance itself");
+  EXPECT_DEATH(art::with(-7, [](art::object&) {}), "with target does not exist");
+}
+
+TEST(object_type, iteration_is_stable_under_create_and_destroy) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  for (int n = 0; n < 3; ++n) {
+    art::instance_create(0, 0, pooled_index);
+  }
+  EXPECT_EQ(3, art::instance_number(pooled_index));
+  
+  int visited = 0;
+  art::with_objects_index(pooled_index, [&visited](const art::object& obj) {
+    ++visited;
+    art::instance_create(0, 0, pooled_index);
+    art::intern::object_from_id(obj._id).instance_destroy();
+  });
+  EXPECT_EQ(3, visited);
+  EXPECT_EQ(3, art::instance_number(pooled_index));
+  
+  art::with_objects_index(pooled_index, [](const art::object& obj) {
+    art::intern::object_from_id(obj._id).instance_destroy();
+  });
+  art::intern::step();
+  EXPECT_EQ(0, art::instance_number(pooled_index));
+  EXPECT_EQ(nullptr, art::intern::object_types[pooled_index].first);
+}
+
+TEST(object_type, with_parent_visits_descendants) {
+  art::intern::object_register<family_object<parent_index>>(parent_index);
+  art::intern::object_register<family_object<child_index>>(child_index, parent_index);
+  art::instance_create(0, 0, parent_index);
+  art::instance_create(0, 0, child_index);
+  art::instance_create(0, 0, child_index);
+  
+  EXPECT_EQ(3, art::instance_number(parent_index));
+  EXPECT_EQ(2, art::instance_number(child_index));
+  
+  int children = 0;
+  art::with_objects_index(parent_index, [&children](const art::object& obj) {
+    children += art::intern::object_is_a(obj, child_index);
+  });
+  EXPECT_EQ(2, children);
+  
+  art::with_objects_index(parent_index, [](const art::object& obj) {
+    art::intern::object_from_id(obj._id).instance_destroy();
+  });
+  art::intern::step();
+  EXPECT_EQ(0, art::instance_number(parent_index));
+}
+
+TEST(motion, integrate_applies_friction_and_gravity) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  std::vector<art::object*> moving;
+  for (int n = 0; n < 7; ++n) {
+    art::object& obj = art::intern::object_from_id(static_cast<art::object::id_t>(art::instance_create(n, 0, pooled_index)));
+    obj.set_hspeed(3);
+    obj.set_vspeed(4);
+    obj.set_friction(1);
+    moving.push_back(&obj);
+  }
+  moving.back()->set_gravity_direction(270);
+  moving.back()->set_gravity(0.5);
+  
+  art::intern::step();
+  for (int n = 0; n < 6; ++n) {
+    EXPECT_DOUBLE_EQ(n, moving[n]->get_xprevious());
+    EXPECT_DOUBLE_EQ(n + 2.4, moving[n]->get_x());
+    EXPECT_DOUBLE_EQ(3.2, moving[n]->get_y());
+    EXPECT_DOUBLE_EQ(4, moving[n]->get_speed());
+  }
+  EXPECT_DOUBLE_EQ(3.7, moving.back()->get_vspeed());
+  
+  for (art::object* obj : moving) {
+    obj->instance_destroy();
+  }
+  art::intern::step();
+}
+
+TEST(motion, destroyed_instances_stay_off_the_dirty_lists) {
+  art::intern::object_register<pooled_object>(pooled_index);
+  art::object& obj = art::intern::object_from_id(static_cast<art::object::id_t>(art::instance_create(0, 0, pooled_index)));
+  obj.set_hspeed(2);
+  art::intern::grid.update();
+  
+  obj.instance_destroy();
+  art::intern::motion.integrate();
+  EXPECT_FALSE(obj._grid.dirty);
+  EXPECT_EQ(art::intern::grid.dirty.end(), std::find(art::intern::grid.dirty.begin(), art::intern::grid.dirty.end(), &obj));
+  art::intern::step();
+}
+
+TEST(motion, velocity_forms_stay_consistent) {
+  test_object a(1, 0);
+  a.set_hspeed(3);
+  a.set_vspeed(-4);
+  EXPECT_DOUBLE_EQ(5, a.get_speed());
+  
+  a.set_speed(10);
+  EXPECT_DOUBLE_EQ(6, a.get_hspeed());
+  EXPECT_DOUBLE_EQ(-8, a.get_vspeed());
+  
+  a.set_direction(0);
+  a.set_speed(2);
+  EXPECT_DOUBLE_EQ(2, a.get_hspeed());
+  EXPECT_NEAR(0, a.get_vspeed(), 1e-12);
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/parallel.hpp"
+
+#include <atomic>
+
+namespace {
+  const art::object::index_t walker_index = 30;
+  const art::object::index_t spawn_index = 31;
+  const art::object::index_t seeker_index = 32;
+
+  struct spawn : art::object {
+    spawn(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(spawn_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+
+    void event_create() {}
+    void event_destroy() {}
+  };
+
+  // Walks right every step, spawning and destroying itself along the way, all from a self-only step event
+  struct walker : art::object {
+    int steps = 0;
+
+    walker(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(walker_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+
+    void step() {
+      this->set_x(this->get_x() + 1);
+      if (++this->steps == 1 && static_cast<int>(this->get_y()) % 3 == 0) {
+        art::instance_create(this->get_x(), this->get_y(), spawn_index);
+      }
+      if (this->steps == 2 && static_cast<int>(this->get_y()) % 5 == 0) {
+        this->instance_destroy();
+      }
+      if (this->steps == 2 && static_cast<int>(this->get_y()) % 7 == 0) {
+        this->set_depth(-this->get_y());
+      }
+    }
+
+    void event_create() {}
+    void event_destroy() {}
+  };
+
+  // Looks for the nearest walker from a self-only step event, which it must not do
+  struct seeker : art::object {
+    seeker(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(seeker_index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+
+    void event_create() {}
+    void event_destroy() {}
+  };
+
+  // Runs a few steps over a fresh set of walkers and describes what is left, in iteration order, with the ids of
+  // what is left in ids
+  std::vector<art::real_t> simulate(std::size_t threads, std::vector<art::real_t>* ids = nullptr) {
+    art::intern::parallel_configure(threads);
+    for (int n = 0; n < 1000; ++n) {
+      art::instance_create(0, n, walker_index);
+    }
+    for (int n = 0; n < 3; ++n) {
+      art::intern::step();
+    }
+
+    std::vector<art::real_t> state;
+    for (art::object::index_t index : {walker_index, spawn_index}) {
+      art::with_objects_index(index, [&state](const art::object& obj) {
+        state.push_back(art::intern::object_from_id(obj._id).get_x());
+        state.push_back(art::intern::object_from_id(obj._id).get_y());
+        state.push_back(art::intern::object_from_id(obj._id).get_depth());
+      });
+      if (ids) {
+        art::with_objects_index(index, [ids](const art::object& obj) {
+          ids->push_back(obj._id);
+        });
+      }
+      art::with_objects_index(index, [](const art::object& obj) {
+        art::intern::object_from_id(obj._id).instance_destroy();
+      });
+    }
+    art::intern::step();
+    art::intern::parallel_configure(0);
+    return state;
+  }
+}
+
+TEST(parallel_step, matches_serial_step) {
+  art::intern::object_register<walker>(walker_index);
+  art::event ev;
+  ev.fn = [](art::object& self, const art::event::metadata_t) { static_cast<walker&>(self).step(); };
+  ev.metadata = 0;
+  ev.type = art::ev_step;
+  ev.status = art::event::st_normal;
+  ev.self_only = true;
+  art::intern::object_register_events(walker_index, {ev});
+  art::intern::object_register<spawn>(spawn_index);
+
+  std::vector<art::real_t> serial = simulate(0);
+  EXPECT_EQ(serial, simulate(4));
+  EXPECT_EQ(serial, simulate(3));
+  
+  // Ids of instances created inside batches follow from the events alone, not from the threads that ran them. They
+  // are compared relative to the first walker, since every run starts from the ids the last one left.
+  std::vector<std::vector<art::real_t>> ids(3);
+  for (std::size_t n = 0; n < ids.size(); ++n) {
+    simulate(n + 2, &ids[n]);
+    art::real_t first = ids[n].front();
+    for (art::real_t& id : ids[n]) {
+      id -= first;
+    }
+  }
+  EXPECT_EQ(ids[0], ids[1]);
+  EXPECT_EQ(ids[0], ids[2]);
+}
+
+TEST(parallel_step, stops_on_shared_queries) {
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  art::intern::object_register<walker>(walker_index);
+  art::intern::object_register<seeker>(seeker_index);
+  art::event ev;
+  ev.fn = [](art::object& self, const art::event::metadata_t) {
+    art::instance_nearest(self.get_x(), self.get_y(), walker_index);
+  };
+  ev.metadata = 0;
+  ev.type = art::ev_step;
+  ev.status = art::event::st_normal;
+  ev.self_only = true;
+  art::intern::object_register_events(seeker_index, {ev});
+  
+  std::vector<art::real_t> ids;
+  for (int n = 0; n < 1000; ++n) {
+    ids.push_back(art::instance_create(0, n, seeker_index));
+  }
+  art::instance_create(0, 0, walker_index);
+  
+  art::intern::parallel_configure(2);
+  EXPECT_DEATH(art::intern::step(), "nearest instance query called from a self-only event");
+  art::intern::parallel_configure(0);
+  
+  // Run on the calling thread the same event is allowed
+  art::intern::step();
+  art::with_objects_all([](art::object& obj) {
+    obj.instance_destroy();
+  });
+  art::intern::step();
+}
+
+TEST(thread_pool, runs_every_task_once) {
+  art::intern::thread_pool pool;
+  pool.start(4);
+  std::vector<std::atomic<int>> runs(1000);
+  for (int round = 0; round < 10; ++round) {
+    pool.run(runs.size(), [&runs](std::size_t n) {
+      ++runs[n];
+    });
+  }
+  for (auto& count : runs) {
+    EXPECT_EQ(10, count);
+  }
+}
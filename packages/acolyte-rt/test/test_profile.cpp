@@ -0,0 +1,136 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/object.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+  const art::object::index_t busy_index = 60;
+  const art::object::index_t idle_index = 61;
+  
+  template <art::object::index_t index>
+  struct profiled : art::object {
+    profiled(art::object::id_t id, art::real_t x, art::real_t y)
+      : object(index, id, x, y, false, true, false, 0, -1, -1) {
+    }
+    
+    void event_create() {}
+    void event_destroy() {}
+  };
+  
+  std::vector<int> garbage;
+  
+  void busy_step(art::object&, const art::event::metadata_t) {
+    garbage.assign(64, 0);
+    garbage.shrink_to_fit();
+    art::with(busy_index, [](art::object&) {});
+  }
+  
+  void idle_step(art::object&, const art::event::metadata_t) {}
+  
+  struct profile_test : testing::Test {
+    void SetUp() {
+      art::intern::object_register<profiled<busy_index>>(busy_index);
+      art::intern::object_register<profiled<idle_index>>(idle_index);
+      for (auto index : {busy_index, idle_index}) {
+        art::event ev;
+        ev.fn = (index == busy_index) ? busy_step : idle_step;
+        ev.metadata = 0;
+        ev.type = art::ev_step;
+        ev.status = art::event::st_normal;
+        art::intern::object_register_events(index, {ev});
+      }
+      art::profile_reset();
+    }
+    
+    void TearDown() {
+      for (auto index : {busy_index, idle_index}) {
+        art::with_objects_index(index, [](const art::object& obj) {
+          art::intern::object_from_id(obj._id).instance_destroy();
+        });
+      }
+      art::intern::step();
+    }
+  };
+}
+
+TEST_F(profile_test, records_events_objects_and_with_blocks) {
+  for (int n = 0; n < 3; ++n) {
+    art::instance_create(0, 0, busy_index);
+  }
+  art::instance_create(0, 0, idle_index);
+  art::profile_reset();
+  art::intern::step();
+  art::intern::step();
+  
+#ifdef ACOLYTE_PROFILE
+  EXPECT_EQ(8, art::profile_event_calls(art::ev_step));
+  EXPECT_EQ(6, art::profile_object_calls(busy_index));
+  EXPECT_EQ(2, art::profile_object_calls(idle_index));
+  EXPECT_EQ(6, art::profile_with_calls());
+  EXPECT_EQ(18, art::profile_with_instances());
+  EXPECT_LE(art::profile_object_time(busy_index), art::profile_event_time(art::ev_step));
+  EXPECT_LE(art::profile_event_time(art::ev_step), art::profile_phase_time(art::ph_step));
+  EXPECT_LE(12, art::profile_phase_allocations(art::ph_step));
+#else
+  EXPECT_EQ(0, art::profile_event_calls(art::ev_step));
+  EXPECT_EQ(0, art::profile_phase_time(art::ph_step));
+#endif
+}
+
+TEST_F(profile_test, counts_the_instances_with_blocks_visit) {
+  std::vector<art::real_t> ids;
+  for (int n = 0; n < 3; ++n) {
+    ids.push_back(art::instance_create(0, 0, busy_index));
+  }
+  art::profile_reset();
+  
+  // The instance destroyed before it is reached is not visited, and neither is the one created during the loop
+  bool changed = false;
+  art::with(busy_index, [&](art::object&) {
+    if (!changed) {
+      changed = true;
+      art::intern::object_from_id(static_cast<art::object::id_t>(ids.back())).instance_destroy();
+      art::instance_create(0, 0, busy_index);
+    }
+  });
+  
+#ifdef ACOLYTE_PROFILE
+  EXPECT_EQ(1, art::profile_with_calls());
+  EXPECT_EQ(2, art::profile_with_instances());
+  
+  // Queries past the end of the tables read as 0 without growing them
+  std::size_t events = art::intern::profile.events.size(), objects = art::intern::profile.objects.size();
+  EXPECT_EQ(0, art::profile_event_calls(1000));
+  EXPECT_EQ(0, art::profile_event_time(-1));
+  EXPECT_EQ(0, art::profile_object_calls(100000));
+  EXPECT_EQ(events, art::intern::profile.events.size());
+  EXPECT_EQ(objects, art::intern::profile.objects.size());
+#else
+  EXPECT_EQ(0, art::profile_with_instances());
+#endif
+}
+
+TEST_F(profile_test, saves_a_chrome_trace) {
+  const char* path = "acolyte_rt_profile_trace.json";
+  art::profile_trace_start();
+  art::instance_create(0, 0, busy_index);
+  art::intern::step();
+  
+#ifdef ACOLYTE_PROFILE
+  ASSERT_TRUE(art::profile_trace_save(path));
+  std::ifstream in(path);
+  std::string trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(0u, trace.find("{\"traceEvents\":[{\"name\":\"alarm\",\"ph\":\"X\""));
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"collision\""));
+  EXPECT_NE(std::string::npos, trace.find("\"ev_step\":\"1 calls"));
+  std::remove(path);
+#else
+  EXPECT_FALSE(art::profile_trace_save(path));
+#endif
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/string.hpp"
+
+#include <unordered_set>
+
+TEST(shared_string, short_strings_are_inline_and_long_ones_shared) {
+  art::string_t empty;
+  EXPECT_EQ(16u, sizeof(art::string_t));
+  EXPECT_TRUE(empty.empty());
+  EXPECT_STREQ("", empty.c_str());
+  
+  art::string_t full("fifteen bytes!!");
+  EXPECT_FALSE(full.is_shared());
+  EXPECT_EQ(15u, full.size());
+  EXPECT_STREQ("fifteen bytes!!", full.c_str());
+  
+  art::string_t longer("sixteen bytes!!!");
+  EXPECT_TRUE(longer.is_shared());
+  EXPECT_EQ(16u, longer.size());
+  EXPECT_STREQ("sixteen bytes!!!", longer.c_str());
+  EXPECT_EQ(std::string(40, 'x'), art::string_t(40, 'x').str());
+}
+
+TEST(shared_string, copies_share_the_characters) {
+  art::string_t original(std::string(100, 'a'));
+  art::string_t copy = original;
+  EXPECT_EQ(original.data(), copy.data());
+  
+  art::string_t moved = std::move(copy);
+  EXPECT_EQ(original.data(), moved.data());
+  EXPECT_TRUE(copy.empty());
+  
+  copy = moved;
+  moved = art::string_t("short");
+  original = art::string_t();
+  EXPECT_EQ(std::string(100, 'a'), copy.str());
+  EXPECT_EQ("short", moved.str());
+}
+
+TEST(shared_string, compares_and_hashes_by_content) {
+  std::string text(50, 'q');
+  art::string_t a(text), b(text), c(text + "r");
+  EXPECT_TRUE(a == b);
+  EXPECT_NE(a.data(), b.data());
+  EXPECT_EQ(a.hash(), b.hash());
+  EXPECT_TRUE(a != c);
+  EXPECT_TRUE(a < c);
+  EXPECT_TRUE(art::string_t("abc") < art::string_t("abd"));
+  EXPECT_TRUE(art::string_t("ab") < art::string_t("abc"));
+  EXPECT_TRUE(art::string_t("\xc3\xa9") > art::string_t("z"));
+  EXPECT_EQ(0, art::string_t("same").compare("same"));
+  
+  std::unordered_set<art::string_t> set = {"one", "two", a};
+  EXPECT_EQ(1u, set.count(b));
+  EXPECT_EQ(1u, set.count("two"));
+  EXPECT_EQ(0u, set.count(c));
+}
+
+TEST(shared_string, concatenates) {
+  art::string_t short_ = art::string_t("abc") + "def";
+  EXPECT_EQ("abcdef", short_.str());
+  EXPECT_FALSE(short_.is_shared());
+  
+  art::string_t long_ = short_ + " and a good deal more";
+  EXPECT_EQ("abcdef and a good deal more", long_.str());
+  EXPECT_TRUE(long_.is_shared());
+  EXPECT_EQ(long_.data(), (long_ + "").data());
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2013 Acolyte Strike Force. All rights reserved.
+// Use of this source code is governed by a BSD3-style license that can be found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "art/variant.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+
+TEST(variant, holds_reals_and_strings_in_sixteen_bytes) {
+  EXPECT_EQ(16u, sizeof(art::variant));
+  
+  art::variant_t none;
+  EXPECT_EQ(art::variant::vt_uninit, none.type());
+  
+  art::variant_t real(-0.25);
+  EXPECT_EQ(art::variant::vt_real, real.type());
+  EXPECT_EQ(-0.25, static_cast<art::real_t>(real));
+  
+  art::variant_t empty = art::string_t();
+  EXPECT_EQ(art::variant::vt_string, empty.type());
+  EXPECT_TRUE(static_cast<art::string_t>(empty).empty());
+  
+  art::variant_t text = art::string_t(std::string(40, 'x'));
+  EXPECT_EQ(art::variant::vt_string, text.type());
+  EXPECT_EQ(std::string(40, 'x'), static_cast<art::string_t>(text).str());
+}
+
+TEST(variant, copies_share_strings_and_moves_leave_uninit) {
+  art::variant_t original = art::string_t(std::string(100, 'a'));
+  art::variant_t copy = original;
+  EXPECT_EQ(original.string().data(), copy.string().data());
+  
+  art::variant_t moved = std::move(copy);
+  EXPECT_EQ(art::variant::vt_uninit, copy.type());
+  EXPECT_EQ(original.string().data(), moved.string().data());
+  
+  // Assigning across kinds releases whatever was held before
+  copy = moved;
+  moved = art::variant_t(1.5);
+  original = copy;
+  copy = art::string_t("short");
+  EXPECT_EQ(1.5, static_cast<art::real_t>(moved));
+  EXPECT_EQ("short", static_cast<art::string_t>(copy));
+  EXPECT_EQ(std::string(100, 'a'), static_cast<art::string_t>(original).str());
+}
+
+TEST(variant, compares_like_its_value) {
+  EXPECT_TRUE(art::variant_t(1.0) < art::variant_t(2.0));
+  EXPECT_TRUE(art::variant_t(2.0) >= art::variant_t(2.0));
+  EXPECT_TRUE(art::variant_t(art::string_t("abc")) < art::variant_t(art::string_t("abd")));
+  EXPECT_TRUE(art::is_real(art::variant_t(0.0)));
+  EXPECT_TRUE(art::is_string(art::variant_t(art::string_t("0"))));
+}
+
+TEST(variant, hashes_agree_with_equality) {
+  EXPECT_EQ(0, art::variant_t(-0.0).compare(art::variant_t(0.0)));
+  EXPECT_EQ(std::hash<art::variant>()(art::variant_t(-0.0)), std::hash<art::variant>()(art::variant_t(0.0)));
+  EXPECT_NE(art::variant_t(1.0), art::variant_t(art::string_t("1")));
+  EXPECT_GT(0, art::variant_t(art::string_t("ab")).compare(art::variant_t(art::string_t("abc"))));
+  
+  std::unordered_map<art::variant, int> map;
+  for (int n = 0; n < 100; ++n) {
+    map[art::variant_t(static_cast<art::real_t>(n))] = n;
+    map[art::variant_t(art::string_t("key " + std::to_string(n) + std::string(n % 2 ? 20 : 0, '.')))] = -n;
+  }
+  EXPECT_EQ(200u, map.size());
+  EXPECT_EQ(42, map[art::variant_t(42.0)]);
+  EXPECT_EQ(-7, map[art::variant_t(art::string_t("key 7" + std::string(20, '.')))]);
+}
+
+TEST(variant, converts_between_reals_and_strings) {
+  EXPECT_EQ("12", art::string(art::variant_t(12.0)));
+  EXPECT_EQ("-3", art::string(art::variant_t(-3.0)));
+  EXPECT_EQ("1.50", art::string(art::variant_t(1.5)));
+  EXPECT_EQ("-0.33", art::string(art::variant_t(-1.0 / 3)));
+  EXPECT_EQ("0.00", art::string(art::variant_t(0.001)));
+  EXPECT_EQ("0.00", art::string(art::variant_t(-0.001)));
+  EXPECT_EQ("100000000000000000000", art::string(art::variant_t(1e20)));
+  EXPECT_EQ("0.1250", art::intern::real_to_string(0.125, 4));
+  EXPECT_EQ("3.14159265358979311600", art::intern::real_to_string(3.141592653589793, 20));
+  
+  EXPECT_EQ(12.5, art::real(art::variant_t(art::string_t("  12.5"))));
+  EXPECT_EQ(-0.25, art::real(art::variant_t(art::string_t("-.25 and more"))));
+  EXPECT_EQ(1500, art::real(art::variant_t(art::string_t("1.5e3"))));
+  EXPECT_EQ(7, art::real(art::variant_t(art::string_t("7e"))));
+  EXPECT_EQ(4, art::real(art::variant_t(4.0)));
+  EXPECT_EQ(1e300, art::intern::string_to_real(art::string_t("1e300")));
+  EXPECT_EQ(0.1, art::intern::string_to_real(art::string_t("0.1000000000000000000000000001")));
+  EXPECT_EQ(123456789012345678901234567890.0, art::intern::string_to_real(art::string_t("123456789012345678901234567890")));
+  
+  // Every value comes back from enough decimals
+  for (art::real_t val : {0.1, 2.0 / 3, 1234.5678, -9007199254740993.0, 5e-324}) {
+    EXPECT_EQ(val, art::intern::string_to_real(art::intern::real_to_string(val, val < 1e-300 ? 340 : 17)));
+  }
+}
+
+TEST(variant, rounds_decimals_like_printf) {
+  EXPECT_EQ("1.11", art::intern::real_to_string(1.115, 2));
+  EXPECT_EQ("2.67", art::intern::real_to_string(2.675, 2));
+  EXPECT_EQ("123456.79", art::intern::real_to_string(123456.785, 2));
+  EXPECT_EQ("0.12", art::intern::real_to_string(0.125, 2));
+  EXPECT_EQ("0.38", art::intern::real_to_string(0.375, 2));
+  EXPECT_EQ("0.100000000000000006", art::intern::real_to_string(0.1, 18));
+  
+  // Halfway and near halfway values at every number of decimals the fast path takes, and a few it does not
+  std::mt19937_64 random(7);
+  char expected[512];
+  for (int n = 0; n < 20000; ++n) {
+    unsigned dec = static_cast<unsigned>(random() % 25);
+    art::real_t val = static_cast<art::real_t>(random() % 2000001) / 2000 * ((n % 3) ? 1 : 1e-3);
+    if (n % 2) {
+      val = std::ldexp(static_cast<art::real_t>(random() >> 11), -static_cast<int>(random() % 64));
+    }
+    std::snprintf(expected, sizeof(expected), "%.*f", static_cast<int>(dec), val);
+    ASSERT_EQ(expected, art::intern::real_to_string(val, dec)) << dec;
+  }
+}
+
+TEST(variant, reads_text_without_a_number_as_zero) {
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  bool number = true;
+  art::real_t val = art::intern::string_to_real(art::string_t("-"), &number);
+  EXPECT_FALSE(number);
+  EXPECT_EQ(0, val);
+  EXPECT_FALSE(std::signbit(val));
+  EXPECT_EQ(0, art::intern::string_to_real(art::string_t("none"), &number));
+  EXPECT_FALSE(number);
+  EXPECT_EQ(0, art::intern::string_to_real(art::string_t("-.e5"), &number));
+  EXPECT_FALSE(number);
+  EXPECT_EQ(-0.5, art::intern::string_to_real(art::string_t("-.5"), &number));
+  EXPECT_TRUE(number);
+  EXPECT_EQ(3, art::intern::string_to_real(art::string_t("3."), &number));
+  EXPECT_TRUE(number);
+  
+  EXPECT_DEATH(art::real(art::variant_t(art::string_t("none"))), "does not start with a number");
+}